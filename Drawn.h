@@ -25,25 +25,733 @@
 #include "TEllipse.h"
 #include "TCurlyLine.h"
 #include "TMath.h"
+#include "TProfile.h"
+#include "TProfile2D.h"
+#include "TROOT.h"
+#include "TDirectory.h"
+#include "TImage.h"
+#include "TLegendEntry.h"
+#include "TFrame.h"
+#include "TSystem.h"
+#include "RConfigure.h"
+#ifdef R__USE_IMT
+#include "ROOT/TThreadExecutor.hxx"
+#endif
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
+#include <limits>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <memory>
+#include <list>
+#include <iterator>
+#include <deque>
+#include <set>
+#include <thread>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
 
 using std::cout;  //  Now the std:: in std::cout can be omitted
 using std::cerr;  //  Preferably use cerr since cout is not always printed exactly where called
 using std::endl;
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//+++++++++++++++++++++++++++++++++++ Themes +++++++++++++++++++++++++++++++++++
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  A theme is a sequence of marker styles, line styles and colors of any length. Objects added with style or color -1 get the next entry of each sequence
+//  (each sequence cycles independently). Colors are ROOT color indices or hex colors written as Themes::RGB | 0xRRGGBB.
+
+struct Theme{
+  const Int_t *markers;
+  Int_t nmarkers;
+  const Int_t *lines;
+  Int_t nlines;
+  const Int_t *colors;
+  Int_t ncolors;
+
+  constexpr Int_t Marker(Int_t i) const { return markers[i % nmarkers]; }
+  constexpr Int_t Line(Int_t i) const { return lines[i % nlines]; }
+  constexpr Int_t Color(Int_t i) const { return colors[i % ncolors]; }
+};
+
+//  The lengths of the sequences are taken from the arrays, so a theme can't read past their ends
+template <Int_t NM, Int_t NL, Int_t NC> constexpr Theme MakeTheme(const Int_t (&markers)[NM], const Int_t (&lines)[NL], const Int_t (&colors)[NC]){
+  return Theme{markers, NM, lines, NL, colors, NC};
+}
+
+namespace Themes{
+  constexpr Int_t RGB = 0x1000000;  //  Marks a color as 0xRRGGBB
+
+  constexpr Int_t ClassicMarkers[] = {20, 21, 34, 33, 27, 24, 28, 22, 23, 29};
+  constexpr Int_t ClassicLines[] = {1, 7, 9, 2, 8};
+  constexpr Int_t ClassicColors[] = {kBlue+1, kRed+1, kGreen+2, kBlack, kOrange+2, kCyan+3, kTeal-7, kPink+2, kYellow+3, kSpring+4};
+
+  //  Colorblind safe palettes (Okabe & Ito; Paul Tol's bright and muted schemes)
+  constexpr Int_t OkabeItoColors[] = {RGB|0x0072B2, RGB|0xD55E00, RGB|0x009E73, RGB|0xCC79A7, RGB|0xE69F00, RGB|0x56B4E9, RGB|0xF0E442, RGB|0x000000};
+  constexpr Int_t TolBrightColors[] = {RGB|0x4477AA, RGB|0xEE6677, RGB|0x228833, RGB|0xCCBB44, RGB|0x66CCEE, RGB|0xAA3377, RGB|0xBBBBBB};
+  constexpr Int_t TolMutedColors[] = {RGB|0x332288, RGB|0x88CCEE, RGB|0x44AA99, RGB|0x117733, RGB|0x999933, RGB|0xDDCC77, RGB|0xCC6677, RGB|0x882255, RGB|0xAA4499};
+
+  constexpr Theme Classic = MakeTheme(ClassicMarkers, ClassicLines, ClassicColors); //  The standard styles of this framework
+  constexpr Theme OkabeIto = MakeTheme(ClassicMarkers, ClassicLines, OkabeItoColors);
+  constexpr Theme TolBright = MakeTheme(ClassicMarkers, ClassicLines, TolBrightColors);
+  constexpr Theme TolMuted = MakeTheme(ClassicMarkers, ClassicLines, TolMutedColors);
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//+++++++++++++++++++++++++++++++++ File cache +++++++++++++++++++++++++++++++++
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Process-wide cache behind the New.. functions that take a file and a key instead of an object. Every file is opened once and every object
+//  is read once, no matter how many plotting objects use it. Both are kept in least recently used order: above the limits the oldest file
+//  is closed and the oldest object is dropped (a dropped object stays alive as long as a plotting object still uses it).
+
+class PlottingFileCache{
+  public:
+
+    //  The object key in file. Returns nullptr and sets error if the file can't be opened or has no such key.
+    //  Hists are detached from their file, so they survive when it is closed
+    static std::shared_ptr<TObject> Get(TString file, TString key, TString &error);
+
+    //  Maximum number of open files and of cached objects (at least 1 each)
+    static void SetLimits(Int_t maxfiles = 64, Int_t maxobjects = 4096);
+
+    //  Close all files and forget all objects
+    static void Clear();
+
+    static Int_t GetOpenFiles();
+    static Int_t GetCachedObjects();
+
+  private:
+
+    //  A map that knows the order in which its entries were used. Find moves the entry to the front, Trim drops entries from the back
+    template <class Key, class Value> struct LRU{
+      std::list<Key> order;
+      std::map<Key, std::pair<Value, typename std::list<Key>::iterator>> entries;
+      Value* Find(const Key &key);
+      void Insert(const Key &key, Value value);
+      void Trim(Int_t max);
+      void Clear();
+    };
+
+    static std::mutex Mutex;  //  Locked during every access, TFile is not thread safe
+    static Int_t MaxFiles;
+    static Int_t MaxObjects;
+    static LRU<TString, std::shared_ptr<TFile>> Files;
+    static LRU<std::pair<TString, TString>, std::shared_ptr<TObject>> Objects;
+};
+
+std::mutex PlottingFileCache::Mutex;
+Int_t PlottingFileCache::MaxFiles = 64;
+Int_t PlottingFileCache::MaxObjects = 4096;
+PlottingFileCache::LRU<TString, std::shared_ptr<TFile>> PlottingFileCache::Files;
+PlottingFileCache::LRU<std::pair<TString, TString>, std::shared_ptr<TObject>> PlottingFileCache::Objects;
+
+template <class Key, class Value> Value* PlottingFileCache::LRU<Key, Value>::Find(const Key &key){
+  auto entry = entries.find(key);
+  if(entry == entries.end()) return nullptr;
+  order.splice(order.begin(), order, entry->second.second);  //  Moving a list node keeps its iterator valid
+  return &entry->second.first;
+}
+
+template <class Key, class Value> void PlottingFileCache::LRU<Key, Value>::Insert(const Key &key, Value value){
+  order.push_front(key);
+  entries[key] = std::make_pair(value, order.begin());
+}
+
+template <class Key, class Value> void PlottingFileCache::LRU<Key, Value>::Trim(Int_t max){
+  while((Int_t)order.size() > max){
+    entries.erase(order.back());
+    order.pop_back();
+  }
+}
+
+template <class Key, class Value> void PlottingFileCache::LRU<Key, Value>::Clear(){
+  entries.clear();
+  order.clear();
+}
+
+std::shared_ptr<TObject> PlottingFileCache::Get(TString file, TString key, TString &error){
+  std::lock_guard<std::mutex> lock(Mutex);
+
+  std::pair<TString, TString> id(file, key);
+  if(std::shared_ptr<TObject> *cached = Objects.Find(id)) return *cached;
+
+  std::shared_ptr<TFile> *open = Files.Find(file);
+  if(!open){
+    //  Close the files before ROOT cleans up at exit (handlers registered later run earlier)
+    static Bool_t registered = false;
+    if(!registered) registered = !std::atexit(Clear);
+    TDirectory::TContext context; //  TFile::Open changes gDirectory, the user should not notice that
+    std::shared_ptr<TFile> opened(TFile::Open(file, "READ"));
+    if(!opened || opened->IsZombie()){
+      error = Form("Could not open file %s", file.Data());
+      return nullptr;
+    }
+    Files.Insert(file, opened);
+    Files.Trim(MaxFiles); //  The new file is in front, so it is never the one that gets closed
+    open = Files.Find(file);
+  }
+
+  TObject *read = (*open)->Get(key);
+  if(!read){
+    error = Form("Could not find %s in %s", key.Data(), file.Data());
+    return nullptr;
+  }
+  TH1 *h = dynamic_cast<TH1*>(read);
+  if(h) h->SetDirectory(nullptr); //  Otherwise closing the file would delete it
+
+  std::shared_ptr<TObject> object(read);
+  Objects.Insert(id, object);
+  Objects.Trim(MaxObjects);
+  return object;
+}
+
+void PlottingFileCache::SetLimits(Int_t maxfiles, Int_t maxobjects){
+  std::lock_guard<std::mutex> lock(Mutex);
+  MaxFiles = TMath::Max(maxfiles, 1);
+  MaxObjects = TMath::Max(maxobjects, 1);
+  Files.Trim(MaxFiles);
+  Objects.Trim(MaxObjects);
+}
+
+void PlottingFileCache::Clear(){
+  std::lock_guard<std::mutex> lock(Mutex);
+  Objects.Clear();
+  Files.Clear();
+}
+
+Int_t PlottingFileCache::GetOpenFiles(){
+  std::lock_guard<std::mutex> lock(Mutex);
+  return Files.order.size();
+}
+
+Int_t PlottingFileCache::GetCachedObjects(){
+  std::lock_guard<std::mutex> lock(Mutex);
+  return Objects.order.size();
+}
+
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//+++++++++++++++++++++++++++++++++ Fast image +++++++++++++++++++++++++++++++++
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  A list of lines, fills, markers and texts in pixel coordinates (origin top left, y downwards) that is written directly as svg,
+//  without canvas, pads or any other part of ROOTs graphics. Used by Plotting1D::SetFastOutput. Colors are 0xAARRGGBB (AA = 0xFF is opaque),
+//  line and marker styles are numbered as in ROOT and texts take the common subset of ROOTs latex (#greek, ^{}, _{}, #it{}, #bf{}, #sqrt{}, ..),
+//  written as real svg text with unicode symbols. Raster formats are left to the TCanvas and TImage, which render text with the real fonts.
+
+class PlottingFastImage{
+  public:
+
+    PlottingFastImage(Int_t width, Int_t height);
+
+    //  Everything added afterwards is clipped to the rectangle [x1,x2]x[y1,y2] until Unclip()
+    void Clip(Double_t x1, Double_t y1, Double_t x2, Double_t y2);
+    void Unclip();
+
+    //  Polyline through the points with width in pixels and a ROOT line style. A NaN coordinate interrupts the line
+    void Line(const std::vector<Double_t> &x, const std::vector<Double_t> &y, UInt_t color, Double_t width = 1, Int_t style = 1);
+
+    //  Filled polygon (even-odd rule)
+    void Fill(const std::vector<Double_t> &x, const std::vector<Double_t> &y, UInt_t color);
+
+    //  The same marker at every point, points with NaN coordinates are skipped. size as in ROOT, where 1 is 8 pixels wide
+    void Markers(const std::vector<Double_t> &x, const std::vector<Double_t> &y, UInt_t color, Int_t style, Double_t size);
+
+    //  Text of size pixels in a ROOT font (42 = helvetica, 62 = helvetica bold, ..) with a ROOT alignment (11 = left bottom, 22 = centered,
+    //  32 = right centered, ..), rotated by angle degrees counterclockwise around (x,y)
+    void Text(Double_t x, Double_t y, TString text, UInt_t color, Double_t size, Int_t font = 42, Int_t align = 11, Double_t angle = 0);
+
+    //  Write the image. False if the file can't be written
+    Bool_t WriteSVG(TString file) const;
+
+    //  The bytes of the svg file in bytes (replacing its content). False if it can't be encoded
+    Bool_t EncodeSVG(std::string &bytes) const;
+
+  private:
+
+    enum ItemKind { kLineItem, kFillItem, kMarkerItem, kTextItem, kClipItem, kUnclipItem };
+    struct Item{
+      ItemKind kind;
+      std::vector<Double_t> x;  //  Points (text: the anchor, clip: the corners)
+      std::vector<Double_t> y;
+      UInt_t color = 0;
+      Double_t size = 1;  //  Line width, marker size or text size
+      Int_t style = 1;  //  Line style, marker style or text font
+      Int_t align = 11;
+      Double_t angle = 0;
+      TString text = "";
+    };
+
+    Int_t Width;
+    Int_t Height;
+    std::vector<Item> Items;
+
+    //  A piece of text in one style. level is +1 per superscript and -1 per subscript
+    struct TextRun{
+      std::string utf8 = "";
+      Int_t level = 0;
+      Bool_t bold = false;
+      Bool_t italic = false;
+    };
+
+    //  Split latex into runs. The font gives the style outside of #bf{} and #it{}
+    static std::vector<TextRun> ParseLatex(TString text, Int_t font);
+    static void ParseLatexGroup(const std::string &s, size_t &i, TextRun style, Bool_t braced, std::vector<TextRun> &runs);
+    static void ParseLatexArgument(const std::string &s, size_t &i, TextRun style, std::vector<TextRun> &runs);
+    static void ParseLatexCommand(const std::string &s, size_t &i, TextRun style, std::vector<TextRun> &runs);
+    static void AddText(std::vector<TextRun> &runs, const TextRun &style, std::string utf8);
+
+    //  Size of a run relative to the text size and its baseline below the one of the text (in text sizes)
+    static Double_t RunScale(const TextRun &run);
+    static Double_t RunShift(const TextRun &run);
+
+    //  Dash and gap lengths of a ROOT line style in pixels (empty for solid lines)
+    static std::vector<Double_t> DashPattern(Int_t style);
+
+    //  Outline of a marker of radius 1 around (0,0). open markers are outlines, strokes markers (+, *, x) are pairs of line ends
+    static void MarkerShape(Int_t style, std::vector<Double_t> &x, std::vector<Double_t> &y, Bool_t &open, Bool_t &strokes);
+
+    //  Radius in pixels of a marker. The dots 1, 6 and 7 have a fixed size in ROOT
+    static Double_t MarkerRadius(Int_t style, Double_t size);
+
+    //  svg attributes and text
+    static std::string SVGColor(UInt_t color, const char* attribute);
+    static std::string SVGEscape(const std::string &text);
+
+};
+
+PlottingFastImage::PlottingFastImage(Int_t width, Int_t height){
+  Width = std::max(width, 1);
+  Height = std::max(height, 1);
+}
+
+void PlottingFastImage::Clip(Double_t x1, Double_t y1, Double_t x2, Double_t y2){
+  Item item;
+  item.kind = kClipItem;
+  item.x = {std::min(x1, x2), std::max(x1, x2)};
+  item.y = {std::min(y1, y2), std::max(y1, y2)};
+  Items.push_back(item);
+}
+
+void PlottingFastImage::Unclip(){
+  Item item;
+  item.kind = kUnclipItem;
+  Items.push_back(item);
+}
+
+void PlottingFastImage::Line(const std::vector<Double_t> &x, const std::vector<Double_t> &y, UInt_t color, Double_t width, Int_t style){
+  if(x.size() < 2 || x.size() != y.size() || width <= 0) return;
+  Item item;
+  item.kind = kLineItem;
+  item.x = x;
+  item.y = y;
+  item.color = color;
+  item.size = width;
+  item.style = style;
+  Items.push_back(item);
+}
+
+void PlottingFastImage::Fill(const std::vector<Double_t> &x, const std::vector<Double_t> &y, UInt_t color){
+  if(x.size() < 3 || x.size() != y.size()) return;
+  Item item;
+  item.kind = kFillItem;
+  item.x = x;
+  item.y = y;
+  item.color = color;
+  Items.push_back(item);
+}
+
+void PlottingFastImage::Markers(const std::vector<Double_t> &x, const std::vector<Double_t> &y, UInt_t color, Int_t style, Double_t size){
+  if(x.empty() || x.size() != y.size() || size <= 0) return;
+  Item item;
+  item.kind = kMarkerItem;
+  item.x = x;
+  item.y = y;
+  item.color = color;
+  item.size = size;
+  item.style = style;
+  Items.push_back(item);
+}
+
+void PlottingFastImage::Text(Double_t x, Double_t y, TString text, UInt_t color, Double_t size, Int_t font, Int_t align, Double_t angle){
+  if(!text.Length() || size <= 0) return;
+  Item item;
+  item.kind = kTextItem;
+  item.x = {x};
+  item.y = {y};
+  item.color = color;
+  item.size = size;
+  item.style = font;
+  item.align = align;
+  item.angle = angle;
+  item.text = text;
+  Items.push_back(item);
+}
+
+std::vector<PlottingFastImage::TextRun> PlottingFastImage::ParseLatex(TString text, Int_t font){
+  //  ROOT fonts are 10*family + precision. Families 1-3 and 5-11 are bold and/or italic variants
+  Int_t family = font/10;
+  TextRun style;
+  style.bold = family == 2 || family == 3 || family == 6 || family == 7 || family == 10 || family == 11;
+  style.italic = family == 1 || family == 3 || family == 5 || family == 7 || family == 9 || family == 11;
+
+  std::vector<TextRun> runs;
+  std::string s = text.Data();
+  size_t i = 0;
+  ParseLatexGroup(s, i, style, false, runs);
+  return runs;
+}
+
+void PlottingFastImage::ParseLatexGroup(const std::string &s, size_t &i, TextRun style, Bool_t braced, std::vector<TextRun> &runs){
+  while(i < s.size()){
+    char c = s[i];
+    if(c == '}'){
+      i++;
+      if(braced) return;
+      continue; //  Unbalanced, ROOT ignores it as well
+    }
+    if(c == '{'){
+      i++;
+      ParseLatexGroup(s, i, style, true, runs);
+      continue;
+    }
+    if(c == '^' || c == '_'){
+      i++;
+      TextRun script = style;
+      script.level += c == '^' ? 1 : -1;
+      ParseLatexArgument(s, i, script, runs);
+      continue;
+    }
+    if(c == '#' && i + 1 < s.size() && isalpha((UChar_t)s[i+1])){
+      ParseLatexCommand(s, i, style, runs);
+      continue;
+    }
+    //  Other bytes are copied, so UTF-8 reaches the svg
+    AddText(runs, style, std::string(1, c));
+    i++;
+  }
+}
+
+void PlottingFastImage::ParseLatexArgument(const std::string &s, size_t &i, TextRun style, std::vector<TextRun> &runs){
+  if(i >= s.size()) return;
+  if(s[i] == '{'){
+    i++;
+    ParseLatexGroup(s, i, style, true, runs);
+  }
+  else if(s[i] == '#' && i + 1 < s.size() && isalpha((UChar_t)s[i+1])) ParseLatexCommand(s, i, style, runs);
+  else{
+    AddText(runs, style, std::string(1, s[i]));
+    i++;
+  }
+}
+
+void PlottingFastImage::ParseLatexCommand(const std::string &s, size_t &i, TextRun style, std::vector<TextRun> &runs){
+  size_t start = ++i;
+  while(i < s.size() && isalpha((UChar_t)s[i])) i++;
+  std::string name = s.substr(start, i - start);
+
+  //  Symbols as unicode
+  static const std::map<std::string, const char*> symbols = {
+    {"alpha", "\u03B1"}, {"beta", "\u03B2"}, {"gamma", "\u03B3"}, {"delta", "\u03B4"},
+    {"epsilon", "\u03B5"}, {"varepsilon", "\u03B5"}, {"zeta", "\u03B6"}, {"eta", "\u03B7"},
+    {"theta", "\u03B8"}, {"iota", "\u03B9"}, {"kappa", "\u03BA"}, {"lambda", "\u03BB"},
+    {"mu", "\u03BC"}, {"nu", "\u03BD"}, {"xi", "\u03BE"}, {"omicron", "\u03BF"}, {"pi", "\u03C0"},
+    {"rho", "\u03C1"}, {"sigma", "\u03C3"}, {"tau", "\u03C4"}, {"upsilon", "\u03C5"},
+    {"phi", "\u03C6"}, {"varphi", "\u03C6"}, {"chi", "\u03C7"}, {"psi", "\u03C8"}, {"omega", "\u03C9"},
+    {"Gamma", "\u0393"}, {"Delta", "\u0394"}, {"Theta", "\u0398"}, {"Lambda", "\u039B"},
+    {"Xi", "\u039E"}, {"Pi", "\u03A0"}, {"Sigma", "\u03A3"}, {"Upsilon", "\u03A5"},
+    {"Phi", "\u03A6"}, {"Psi", "\u03A8"}, {"Omega", "\u03A9"},
+    {"pm", "\u00B1"}, {"mp", "\u2213"}, {"times", "\u00D7"}, {"cdot", "\u00B7"}, {"minus", "\u2212"},
+    {"leq", "\u2264"}, {"geq", "\u2265"}, {"neq", "\u2260"}, {"approx", "\u2248"}, {"sim", "\u223C"},
+    {"rightarrow", "\u2192"}, {"leftarrow", "\u2190"}, {"leftrightarrow", "\u2194"}, {"to", "\u2192"},
+    {"infty", "\u221E"}, {"circ", "\u00B0"}, {"degree", "\u00B0"}, {"prime", "\u2032"},
+    {"partial", "\u2202"}, {"nabla", "\u2207"}, {"hbar", "\u0127"}, {"ell", "\u2113"},
+    {"sum", "\u2211"}, {"int", "\u222B"}, {"AA", "\u00C5"}, {"dagger", "\u2020"}
+  };
+
+  if(name == "it" || name == "bf"){
+    if(name == "it") style.italic = true;
+    else style.bold = true;
+    ParseLatexArgument(s, i, style, runs);
+  }
+  else if(name == "font" || name == "color"){  //  The font and color of the whole text are used
+    if(i < s.size() && s[i] == '['){
+      size_t close = s.find(']', i);
+      i = close == std::string::npos ? s.size() : close + 1;
+    }
+    ParseLatexArgument(s, i, style, runs);
+  }
+  else if(name == "splitline" || name == "frac"){ //  Written on one line
+    ParseLatexArgument(s, i, style, runs);
+    AddText(runs, style, name == "frac" ? "/" : " ");
+    ParseLatexArgument(s, i, style, runs);
+  }
+  else if(name == "sqrt"){
+    AddText(runs, style, "\u221A");
+    ParseLatexArgument(s, i, style, runs);
+  }
+  else if(name == "bar" || name == "hat" || name == "tilde" || name == "vec" || name == "dot" || name == "ddot" || name == "overline" || name == "underline"){
+    ParseLatexArgument(s, i, style, runs); //  Accents are left out
+  }
+  else{
+    auto symbol = symbols.find(name);
+    if(symbol != symbols.end()) AddText(runs, style, symbol->second);
+    else AddText(runs, style, "#" + name);
+  }
+}
+
+void PlottingFastImage::AddText(std::vector<TextRun> &runs, const TextRun &style, std::string utf8){
+  if(runs.size() && runs.back().level == style.level && runs.back().bold == style.bold && runs.back().italic == style.italic){
+    runs.back().utf8 += utf8;
+    return;
+  }
+  TextRun run = style;
+  run.utf8 = utf8;
+  runs.push_back(run);
+}
+
+Double_t PlottingFastImage::RunScale(const TextRun &run){
+  return std::pow(0.7, std::abs(run.level));
+}
+
+Double_t PlottingFastImage::RunShift(const TextRun &run){
+  return run.level > 0 ? -0.45*run.level : -0.2*run.level;
+}
+
+std::vector<Double_t> PlottingFastImage::DashPattern(Int_t style){
+  //  The patterns of ROOTs line styles 2-10 (see TStyle::SetLineStyleString)
+  switch(style){
+    case 2: return {12, 12};
+    case 3: return {4, 8};
+    case 4: return {12, 16, 4, 16};
+    case 5: return {20, 12, 4, 12};
+    case 6: return {20, 12, 4, 12, 4, 12, 4, 12};
+    case 7: return {20, 20};
+    case 8: return {20, 12, 4, 12, 4, 12};
+    case 9: return {80, 20};
+    case 10: return {80, 20, 4, 20};
+    default: return {};
+  }
+}
+
+void PlottingFastImage::MarkerShape(Int_t style, std::vector<Double_t> &x, std::vector<Double_t> &y, Bool_t &open, Bool_t &strokes){
+  x.clear();
+  y.clear();
+  open = style == 4 || style == 24 || style == 25 || style == 26 || style == 27 || style == 28 || style == 30 || style == 32;
+  strokes = style == 2 || style == 3 || style == 5;
+  auto add = [&](Double_t px, Double_t py){ x.push_back(px); y.push_back(py); };
+  switch(style){
+    case 1: case 6: case 7: case 21: case 25:
+      add(-1, -1); add(1, -1); add(1, 1); add(-1, 1);
+      break;
+    case 22: case 26:
+      add(0, -1); add(0.9, 0.6); add(-0.9, 0.6);
+      break;
+    case 23: case 32:
+      add(0, 1); add(-0.9, -0.6); add(0.9, -0.6);
+      break;
+    case 27: case 33:
+      add(0, -1); add(0.6, 0); add(0, 1); add(-0.6, 0);
+      break;
+    case 28: case 34:
+      add(-0.3, -1); add(0.3, -1); add(0.3, -0.3); add(1, -0.3); add(1, 0.3); add(0.3, 0.3);
+      add(0.3, 1); add(-0.3, 1); add(-0.3, 0.3); add(-1, 0.3); add(-1, -0.3); add(-0.3, -0.3);
+      break;
+    case 29: case 30:
+      for( Int_t k = 0; k < 10; ++k){
+        Double_t r = k % 2 ? 0.4 : 1;
+        Double_t phi = TMath::Pi()*(-0.5 + 0.2*k);
+        add(r*std::cos(phi), r*std::sin(phi));
+      }
+      break;
+    case 2: case 3: case 5:
+      if(style != 5){ add(-1, 0); add(1, 0); add(0, -1); add(0, 1); }
+      if(style != 2){ add(-0.7, -0.7); add(0.7, 0.7); add(-0.7, 0.7); add(0.7, -0.7); }
+      break;
+    default:  //  Circles (20, 24, 4, 8) and everything else
+      for( Int_t k = 0; k < 16; ++k) add(std::cos(TMath::Pi()*k/8), std::sin(TMath::Pi()*k/8));
+  }
+}
+
+Double_t PlottingFastImage::MarkerRadius(Int_t style, Double_t size){
+  if(style == 1) return 0.5;
+  if(style == 6) return 1;
+  if(style == 7) return 1.5;
+  return 4*size;
+}
+
+std::string PlottingFastImage::SVGColor(UInt_t color, const char* attribute){
+  std::string s = Form(" %s=\"#%06x\"", attribute, color & 0xffffff);
+  UInt_t alpha = color >> 24;
+  if(alpha != 0xff) s += Form(" %s-opacity=\"%.3f\"", attribute, alpha/255.);
+  return s;
+}
+
+std::string PlottingFastImage::SVGEscape(const std::string &text){
+  std::string escaped;
+  for(char c : text){
+    if(c == '&') escaped += "&amp;";
+    else if(c == '<') escaped += "&lt;";
+    else if(c == '>') escaped += "&gt;";
+    else if(c == '"') escaped += "&quot;";
+    else escaped += c;
+  }
+  return escaped;
+}
+
+Bool_t PlottingFastImage::WriteSVG(TString file) const{
+  std::string svg;
+  EncodeSVG(svg);
+  std::ofstream out(file.Data(), std::ios::binary);
+  out.write(svg.data(), svg.size());
+  return out.good();
+}
+
+Bool_t PlottingFastImage::EncodeSVG(std::string &svg) const{
+
+  svg.clear();
+  char number[64];
+  auto point = [&](char command, Double_t x, Double_t y){
+    snprintf(number, sizeof(number), "%c%.1f %.1f", command, x, y);
+    svg += number;
+  };
+
+  svg += Form("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n",
+              Width, Height, Width, Height);
+  svg += "<rect width=\"100%\" height=\"100%\" fill=\"#ffffff\"/>\n";
+
+  Int_t clips = 0;
+  Bool_t clipped = false;
+  std::vector<Double_t> mx, my;
+  for(const Item &item : Items){
+    switch(item.kind){
+      case kClipItem:
+        if(clipped) svg += "</g>\n";
+        svg += Form("<clipPath id=\"clip%d\"><rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\"/></clipPath>\n<g clip-path=\"url(#clip%d)\">\n",
+                    clips, item.x[0], item.y[0], item.x[1] - item.x[0], item.y[1] - item.y[0], clips);
+        clips++;
+        clipped = true;
+        break;
+
+      case kUnclipItem:
+        if(clipped) svg += "</g>\n";
+        clipped = false;
+        break;
+
+      case kLineItem:{
+        svg += "<path d=\"";
+        Bool_t pen = false;
+        for( Int_t i = 0; i < (Int_t)item.x.size(); ++i){
+          if(std::isnan(item.x[i]) || std::isnan(item.y[i])) { pen = false; continue; }
+          point(pen ? 'L' : 'M', item.x[i], item.y[i]);
+          pen = true;
+        }
+        svg += "\" fill=\"none\"" + SVGColor(item.color, "stroke");
+        svg += Form(" stroke-width=\"%g\" stroke-linejoin=\"round\"", item.size);
+        std::vector<Double_t> dashes = DashPattern(item.style);
+        if(dashes.size()){
+          svg += " stroke-dasharray=\"";
+          for( Int_t k = 0; k < (Int_t)dashes.size(); ++k) svg += Form(k ? ",%g" : "%g", dashes[k]);
+          svg += "\"";
+        }
+        svg += "/>\n";
+        break;
+      }
+
+      case kFillItem:
+        svg += "<path d=\"";
+        for( Int_t i = 0; i < (Int_t)item.x.size(); ++i) point(i ? 'L' : 'M', item.x[i], item.y[i]);
+        svg += "Z\"" + SVGColor(item.color, "fill") + " fill-rule=\"evenodd\"/>\n";
+        break;
+
+      case kMarkerItem:{
+        //  All markers of the item are one path: an absolute move to each point followed by the relative outline of the marker
+        Bool_t open, strokes;
+        MarkerShape(item.style, mx, my, open, strokes);
+        Double_t r = MarkerRadius(item.style, item.size);
+        std::string shape;
+        if(strokes){
+          Double_t cx = 0, cy = 0;
+          for( Int_t k = 0; k + 1 < (Int_t)mx.size(); k += 2){
+            shape += Form("m%.2f %.2fl%.2f %.2f", r*mx[k] - cx, r*my[k] - cy, r*(mx[k+1] - mx[k]), r*(my[k+1] - my[k]));
+            cx = r*mx[k+1];
+            cy = r*my[k+1];
+          }
+        }
+        else{
+          shape += Form("m%.2f %.2f", r*mx[0], r*my[0]);
+          for( Int_t k = 1; k < (Int_t)mx.size(); ++k) shape += Form("l%.2f %.2f", r*(mx[k] - mx[k-1]), r*(my[k] - my[k-1]));
+          shape += "z";
+        }
+        svg += "<path d=\"";
+        for( Int_t i = 0; i < (Int_t)item.x.size(); ++i){
+          if(std::isnan(item.x[i]) || std::isnan(item.y[i])) continue;
+          point('M', item.x[i], item.y[i]);
+          svg += shape;
+        }
+        if(open || strokes) svg += "\" fill=\"none\"" + SVGColor(item.color, "stroke") + " stroke-width=\"1\"/>\n";
+        else svg += "\"" + SVGColor(item.color, "fill") + "/>\n";
+        break;
+      }
+
+      case kTextItem:{
+        Int_t family = item.style/10;
+        const char* face = (family <= 3 || family == 13) ? "Times New Roman, Times, serif" : (family >= 8 && family <= 11 ? "Courier New, Courier, monospace" : "Helvetica, Arial, sans-serif");
+        Int_t halign = item.align/10;
+        Int_t valign = item.align%10;
+        const char* anchor = halign == 2 ? "middle" : (halign == 3 ? "end" : "start");
+        //  The vertical alignment moves the baseline in the rotated frame, so it is added before the rotation
+        Double_t baseline = item.y[0] + (valign == 2 ? 0.35 : (valign == 3 ? 0.7 : 0))*item.size;
+        svg += Form("<text x=\"%.1f\" y=\"%.1f\" font-family=\"%s\" font-size=\"%.1f\" text-anchor=\"%s\"", item.x[0], baseline, face, item.size, anchor);
+        svg += SVGColor(item.color, "fill");
+        if(item.angle != 0) svg += Form(" transform=\"rotate(%g %.1f %.1f)\"", -item.angle, item.x[0], item.y[0]);
+        svg += " xml:space=\"preserve\">";
+        Double_t shift = 0;
+        for(const TextRun &run : ParseLatex(item.text, item.style)){
+          svg += "<tspan";
+          if(run.bold) svg += " font-weight=\"bold\"";
+          if(run.italic) svg += " font-style=\"italic\"";
+          if(run.level) svg += Form(" font-size=\"%.1f\"", item.size*RunScale(run));
+          if(RunShift(run) != shift) svg += Form(" dy=\"%.1f\"", (RunShift(run) - shift)*item.size);
+          shift = RunShift(run);
+          svg += ">" + SVGEscape(run.utf8) + "</tspan>";
+        }
+        svg += "</text>\n";
+        break;
+      }
+    }
+  }
+  if(clipped) svg += "</g>\n";
+  svg += "</svg>\n";
+  return true;
+}
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //++++++++++++++++++++++++++++++++++ Plotting ++++++++++++++++++++++++++++++++++
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 //  The Plotting-class itself is never used but all the other classes inherit functions and attributes from it
 
 class Plotting{
+  friend class PlottingBook;  //  Aborts through Plotting::Abort (see DrawnBook.h)
+  friend class PlottingGrid;  //  Draws plotting objects into its pads
+
   public:
 
     Plotting(); // Empty constructor
 
-    ~Plotting();  // Empty destructor
+    virtual ~Plotting();  // Deletes all objects the plotting object owns (Latex, lines and everything left of the last Plot())
+
+    //  The owned objects would be deleted twice by a copy
+    Plotting(const Plotting&) = delete;
+    Plotting& operator=(const Plotting&) = delete;
 
     //  Universal function for setting the legends relative position on the canvas
     void SetLegend(Double_t x1 = 0.15, Double_t x2 = 0.4, Double_t y1 = 0.7, Double_t y2 = 0.9);
@@ -60,68 +768,868 @@ class Plotting{
     //  Set the relative empty space between hist and the edges aswell as the canvas dimensions in pixel
     void SetMargins(Double_t low = 0.1, Double_t left = 0.1, Double_t up = 0.01, Double_t right = 0.01, Int_t cw = 1200, Int_t ch = 1000);
 
+    //  Export every Plot() in several formats from a single render. Use ; to split formats: SetFormats("pdf;png;svg") makes Plot("Example") write Example.pdf, Example.png and Example.svg
+    void SetFormats(TString formats = "");
+
+    //  Keep the files of every Plot() in memory instead of writing them: Plot("Example") with SetFormats("png;svg") fills the buffers "Example.png"
+    //  and "Example.svg" (see TakeOutput). png, jpg and gif of a canvas and the svg of SetFastOutput are encoded in memory. ROOT writes pdf, svg
+    //  and the other vector formats of a canvas only to files, so these go through a temporary file that is deleted right away
+    void SetMemoryOutput(Bool_t memory = true);
+
+    //  Move the bytes of file of the last Plot() into buffer. False if the last Plot() made no such file
+    Bool_t TakeOutput(TString file, std::string &buffer);
+
+    //  Also write the canvas of every Plot() as an object named like the plot (without directory and extension) into directory, e.g. an open TFile
+    //  or TMemFile. The directory belongs to the caller and has to stay open while plotting. 0 stops it
+    void SetOutputDirectory(TDirectory *directory);
+
+    //  Open a multi-page pdf. Until CloseBook() is called every Plot() of any plotting object adds its canvas as a new page. Plot("") then only adds the page and writes no other file.
+    static void OpenBook(TString bookname = "Book.pdf");
+    static void CloseBook();
+
+    //  Call once before plotting from several threads. Independent plotting objects can then call Plot() at the same time (in batch mode).
+    //  Building the scenes runs in parallel, writing the files is serialized because ROOTs output backends (gVirtualPS) and the palette are global.
+    static void EnableThreadSafety();
+
+    //  Write the files in a background thread (calls EnableThreadSafety). Plot() hands the drawn canvas (or the image of SetFastOutput) to a queue
+    //  and returns, so the next plot is built while the last ones are encoded and written. Plot() waits while queuesize plots are queued.
+    //  Objects that outlive the Plot() (hists, graphs, funcs, latex and lines) are copied for the writer, so they can be changed or deleted right away.
+    //  Persistent canvases stay with their plotting object and are written without the queue. 0 flushes the queue and writes synchronously again
+    static void SetAsyncOutput(Int_t queuesize = 8);
+
+    //  Wait until every queued plot is written. Files that could not be written are reported through Abort (also by the next Plot() that is queued)
+    static void FlushOutput();
+
+    //  Keep canvas, pads, frames and legends after Plot() (used by Plotting1D and PlottingRatio). As long as no New.., Set.. or Draw.. function is called, the next Plot()
+    //  only recalculates the axis ranges and repaints if the hists, graphs or funcs changed, and does nothing at all if also the name is the same. For live-updating plots.
+    void SetPersistent(Bool_t persistent = true);
+
+    //  Paint the data layer (the hist of Plotting2D, the graphs of Plotting1D) into the frame as a bitmap with dpi pixels per inch of the pdf page.
+    //  Axes, labels, latex, lines, hists, functions and legends stay vector graphics, so dense maps and scatter plots give small pdfs that open instantly.
+    void SetRaster(Bool_t raster = true, Int_t dpi = 300);
+
+    //  Draw the functions of Plotting1D and PlottingRatio that are drawn as lines as polylines sampled for the pixels of the frame: starting from a point every
+    //  2 pixels, a segment is halved as long as the function passes its middle more than tolerance pixels away, so sharp peaks get many points and flat parts few.
+    //  The points are cached per function and reused as long as its parameters, its range and the axes did not change. threads > 1 evaluates each round
+    //  of halving in parallel on a pool of threads started here (0 uses all cores), which needs a function that can be evaluated concurrently (TF1Convolution for example can't)
+    //  and a ROOT built with imt, otherwise threads is ignored
+    void SetFuncSampling(Bool_t adaptive = true, Double_t tolerance = 0.25, Int_t threads = 1);
+
+    //  Select the theme (see Themes) for everything added afterwards with style or color -1. With hashLabels a labeled object gets its style
+    //  from its label instead of its position, so the same series looks the same in every plot. Unlabeled objects always use the position
+    void SetTheme(const Theme &theme = Themes::Classic, Bool_t hashLabels = false);
+
+    //  How NewBand (Plotting1D and PlottingRatio) combines the variations of a nominal hist in every bin
+    enum BandMode{
+      kEnvelope,  //  From the lowest to the highest of the nominal and all variations
+      kQuadrature //  Nominal minus/plus the quadratic sums of the downward/upward deviations of the variations
+    };
+
+    //  By default Abort() ends the program with a failure exit code. With true it throws a std::runtime_error instead, so the caller can skip the broken plot and continue.
+    static void SetThrowOnAbort(Bool_t doThrow = true);
+
+    //  Skip Plot() entirely if all its files were already written from exactly the same input. A fingerprint of everything that affects the output
+    //  (contents and errors, points, parameters, styles, labels, ranges, margins, latex, formats) is kept per file in indexfile, together with the
+    //  size and modification time of the file. Changed or deleted files are written again. Plots are always drawn while a book is open.
+    static void SetCache(TString indexfile = ".DrawnCache");
+    static Int_t GetCacheHits();
+    static Int_t GetCacheMisses();
+    static void PrintCacheStatistics();
+
+    //  The phases of Plot(): reading lazy objects and checking the cache, creating the canvas and pads, the axes (including their autoset ranges),
+    //  drawing hists, graphs, funcs, lines and latex, building and drawing the legends and writing the files
+    enum ProfilePhase { kInputPhase, kCanvasPhase, kAxisPhase, kDrawPhase, kLegendPhase, kExportPhase, kNPhases };
+
+    //  What a single Plot() did and how long each phase took
+    struct PlotProfile{
+      TString plotclass = "";
+      TString name = "";
+      TString result = "drawn"; //  drawn, updated (persistent canvas with new ranges), unchanged (persistent, nothing to do), cached (see SetCache) or aborted
+      Double_t seconds[kNPhases] = {0};
+      Long64_t objects = 0; //  Hists, graphs, funcs, lines and latex drawn
+      Long64_t bins = 0;  //  Bins of the drawn hists
+      Long64_t points = 0;  //  Points of the drawn graphs (after decimation) and sampling points of the drawn funcs
+      Long64_t bytes = 0; //  Size of the written files or buffers of SetMemoryOutput (without book pages)
+      Bool_t async = false; //  Written by the background writer (SetAsyncOutput). The writer adds bytes to the stored profile once the files are written, GetLastProfile has 0
+      Double_t Total() const;
+      static const char* PhaseName(Int_t phase);
+    };
+
+    //  Record a PlotProfile for every Plot() of every plotting object. Off by default, then Plot() only pays a few untaken branches
+    static void EnableProfiling(Bool_t profiling = true);
+
+    //  The profiles recorded so far in this process, in the order the plots finished, and the one of the last Plot() of this object.
+    //  Call FlushOutput first to get the bytes of all asynchronously written plots
+    static std::vector<PlotProfile> GetProfiles();
+    const PlotProfile& GetLastProfile() const;
+    static void ResetProfiles();
+
+    //  Sums of all profiles per plotting class (and of all classes) with the process id. Written as JSON if file ends with .json, as CSV otherwise.
+    //  Waits for the background writer first, so the bytes of asynchronous plots are included. async counts the plots written by it
+    static void WriteProfileReport(TString file = "DrawnProfile.csv");
+
   protected:
 
-    TCanvas *Canvas = nullptr;  //  The canvas that all classes plot on
+    TPad *Canvas = nullptr;  //  The canvas that all classes plot on. In a PlottingGrid it is the pad of the panel
+    TPad *HostPad = nullptr; //  Set by PlottingGrid while its panels are drawn. Then Plot() draws into this pad, writes nothing and keeps everything until ReleaseHost()
 
-    TH2D* hDummy = nullptr; //  Empty histogram with the correct axis ranges and labels plotted first
+    TH2D* hDummy = nullptr; //  Empty frame with the correct axis ranges and labels plotted first
 
     TLegend *leg = nullptr;
 
     //  Vectors of elements that are added by New... functions and are drawn in the Plot() functions
-    std::vector<TH1F*> hists;
+    std::vector<TH1*> hists;
     std::vector<TGraph*> graphs;
     std::vector<TF1*> funcs;
     std::vector<TLine*> lines;
     std::vector<TCurlyLine*> clines;
     std::vector<TLatex*> Latex;
 
-    std::vector<TString> DrawOption;  //  A histogram is plotted using the corresponding DrawOption ("p","h",..)
+    //  A draw option as given by the user, parsed once when the object is added
+    enum DrawnKind { kHistKind, kRatioKind, kGraphKind, kFuncKind, kMapKind };
+    struct DrawOpt{
+      TString draw = "";  //  Given to Draw() (after "same")
+      TString legend = "p"; //  Option of the legend entry
+      Bool_t line = false;  //  Drawn as a line, so an explicit line style is used (hists: "h", graphs: "l")
+      Bool_t straight = false;  //  Only straight lines between the points (no markers, curves, bars or fills), see SetDecimation. Funcs: only a line, see SetFuncSampling
+    };
+    static DrawOpt ParseDrawOption(TString opt, DrawnKind kind);
+
+    std::vector<DrawOpt> DrawOption;  //  A histogram is plotted using the corresponding DrawOption ("p","h",..)
     std::vector<TString> LegendLabel; //  Strings corresponding to histograms are added to legend
     std::vector<TString> LegendLabelF;
-    std::vector<TString> DrawOptionF;
+    std::vector<DrawOpt> DrawOptionF;
     std::vector<TString> LegendLabelG;
-    std::vector<TString> DrawOptionG;
+    std::vector<DrawOpt> DrawOptionG;
     std::vector<TString>  LegendLabelL; //  Strings corresponding to lines are added to legend (if not empty)
 
     //  The following are standard settings that can be changes by calling Set.. functions before Plot()
     Double_t AxisRange[3][2] = {{42,42},{42,42},{0,2}}; // xlow,xuo,ylow,yup,zlow,zup (in PlottingRatio z=ratio)
+    Double_t UserAxisRange[3][2] = {{42,42},{42,42},{0,2}}; //  AxisRange as set by the user. AutoSetAxisRanges overwrites AxisRange, CleanUp restores it, so the next Plot() autosets again
     TString AxisLabel[3] = {"x","y","Ratio"};
     Double_t AxisLabelOffset[2] = {1.,1.};  // Third component not needed for ratio trivial, for 2D z has no Label currently
     Double_t LegendBorders[2][2] = {{0.15,0.4},{0.7,0.9}};  //  xlow,xup,ylow,yup in relative units (0-1)
     Double_t CanvasMargins[2][2] = {{0.1,0.01},{0.1,0.01}}; //  left,right,low,up in relative units
     Int_t CanvasDimensions[2] = {1200,1000};  // Dimension given in pixels
+    std::vector<TString> Formats; //  File extensions written by Export(). If empty the name given to Plot() is used as it is
+    Bool_t MemoryOutput = false;  //  Set by SetMemoryOutput
+    std::map<TString, std::string> OutputBuffers; //  The files of the last Plot() with MemoryOutput
+    TDirectory *OutputDirectory = nullptr;  //  Set by SetOutputDirectory
+
+    static TString BookName;  //  The multi-page pdf opened by OpenBook(). Empty if no book is open
+    static Int_t BookPages; //  Number of pages already printed into the book
+
+    static std::recursive_mutex OutputMutex;  //  Locked while a canvas is written or global style (palette) is needed for painting
+    static std::atomic<Int_t> NameCounter;  //  Makes the names of canvases, pads and frames unique across all plotting objects and threads
+    static Bool_t ThrowOnAbort; //  Set by SetThrowOnAbort
+
+    //  The background writer (see SetAsyncOutput). Jobs run one after the other in the order they were queued, so book pages keep their order
+    static std::atomic<Int_t> AsyncQueueSize;  //  0 if the output is synchronous
+    static std::mutex QueueMutex; //  Guards Queue, Writing and OutputErrors. Never locked while waiting for the OutputMutex
+    static std::condition_variable QueueChanged;
+    static std::deque<std::function<void()>> Queue;
+    static Bool_t Writing;  //  A job was taken from the queue and is not finished yet
+    static std::vector<TString> OutputErrors; //  Messages of failed jobs, not reported yet
+    static std::thread Writer;
+
+    //  Loop of the writer thread. Returns when the output is synchronous again and the queue is empty
+    static void WriteQueue();
+
+    //  Wait for space in the queue and add job. A job reports errors by throwing. Earlier errors are reported here through Abort
+    static void Enqueue(std::function<void()> job);
+
+    //  Wait until the queue is empty and no job is running
+    static void WaitForWriter();
+
+    //  Finish the queue and join the writer. Registered with atexit, so files are complete when the program ends
+    static void StopWriter();
+
+    //  All messages of OutputErrors in one string (empty if there are none)
+    static TString TakeOutputErrors();
+
+    //  The output cache (see SetCache). For every written file its fingerprint, size and modification time
+    struct CacheEntry{
+      ULong64_t fingerprint = 0;
+      Long64_t size = -1;
+      Long_t modtime = 0;
+    };
+    static TString CacheIndex;  //  Empty if the cache is off
+    static std::map<TString, CacheEntry> CacheEntries;
+    static std::atomic<Int_t> CacheHits;
+    static std::atomic<Int_t> CacheMisses;
+
+    //  If no style and or color are set the entries of the theme are used one after the other
+    Theme CurrentTheme = Themes::Classic;
+    Bool_t HashLabels = false;
+    Int_t counter = 0;  //  Count up after each added histogram and use the entry counter of the theme -> Unique colors and styles
+
+    //  Set marker/line style, colors, size and width of a hist, graph or function. Style and color -1 (and linestyle -1) are taken from the theme entry
+    //  of position count, or of the label if HashLabels is set. All New.. functions go through here
+    template <class T> void ApplyStyle(T* obj, Int_t count, TString label, Int_t style, Int_t size, Int_t color, Int_t linestyle);
+
+    //  The ROOT color index of a theme color (hex colors are registered with TColor)
+    static Int_t ThemeColor(Int_t color);
+
+    //  State of the persistent mode (see SetPersistent)
+    Bool_t Persistent = false;
+    Bool_t SceneChanged = true; //  Set by every New.., Set.. and Draw.. function, because then the persistent canvas has to be rebuilt
+    std::vector<Double_t> LastSignature;  //  DataSignature() of the last Plot()
+    TString LastName = "";  //  Name given to the last Plot()
+    Int_t LastLogs = -1;  //  Log settings of the last Plot() as bits (x, y, z)
+
+    //  Settings of SetRaster
+    Bool_t Raster = false;
+    Int_t RasterDPI = 300;
+
+    //  Settings of SetFuncSampling
+    Bool_t FuncSampling = false;
+    Double_t SamplingTolerance = 0.25;
+#ifdef R__USE_IMT
+    std::unique_ptr<ROOT::TThreadExecutor> SamplingPool;  //  Created by SetFuncSampling if more than one thread is used. Reused by every round of every Plot()
+#endif
 
-    //  If no style and or color are set these 10 standard styles and colors are used one after the other
-    Int_t AutoStyle[10] = {20, 21, 34, 33, 27, 24, 28, 22, 23,29};
-    Int_t AutoStyleLine[10] = {1, 7, 9, 2, 8, 1, 7, 9, 2, 8};
-    Int_t AutoColor[10] = {kBlue+1, kRed+1, kGreen+2, kBlack, kOrange+2, kCyan+3, kTeal-7, kPink+2, kYellow+3, kSpring+4};
-    Int_t counter = 0;  //  Count up after each added histogram and use e.g. AutoStyle[counter] -> Unique colors and styles
+    //  The sampled points of a function and the graph drawn from them
+    struct FuncSamples{
+      std::vector<Double_t> signature;  //  Window, log x and parameters the points belong to
+      Bool_t logy = false;
+      Double_t scale[2] = {0, 0}; //  Pixels per unit of (log) x and y the points are fine enough for
+      std::vector<Double_t> x, y; //  Sorted in x. y can be infinite or NaN (e.g. at poles)
+      TGraph *graph = nullptr;  //  Owned, only the valid points
+    };
+    std::map<const TF1*, FuncSamples> SampleCache;
+
+    //  The points of f inside [xlow,xup], fine enough for a frame of w x h pixels showing [ylow,yup]. Refines the cached points if they are too coarse
+    FuncSamples& SampleFunc(TF1* f, Double_t xlow, Double_t xup, Double_t ylow, Double_t yup, Bool_t logx, Bool_t logy, Double_t w, Double_t h);
+
+    //  The graph of SampleFunc for the x range of the plot and the frame of pad, with the line attributes of f
+    TGraph* SampledFunc(TF1* f, TPad* pad, Double_t ylow, Double_t yup, Bool_t logx, Bool_t logy);
+
+    //  y[i] = f(x[i]) on the SamplingPool, serially for a few points and in a ROOT built without imt
+    void EvalFunc(TF1* f, const std::vector<Double_t> &x, std::vector<Double_t> &y);
+
+    //  Fingerprints of the data of an object for the persistent mode. Hists use the hash of their content and sumw2 arrays (a byte-wise pass over both,
+    //  slower than scanning the bins, but the only way to see every change), graphs the sums of their points, funcs the parameters
+    static void AppendSignature(std::vector<Double_t> &signature, TH1* h);
+    static void AppendSignature(std::vector<Double_t> &signature, TGraph* g);
+    static void AppendSignature(std::vector<Double_t> &signature, TF1* f);
+
+    //  Fingerprint of all hists, graphs and funcs. If it did not change, the drawn data did not change
+    std::vector<Double_t> DataSignature();
+
+    //  Remember what the persistent canvas shows after a full Plot()
+    void KeepScene(TString name, Int_t logs, std::vector<Double_t> signature);
+
+    //  64 bit FNV-1a hash of everything that affects the output of a plot
+    struct Fingerprint{
+      ULong64_t hash = 14695981039346656037ULL;
+      void Add(const void* data, size_t size);
+      void Add(Double_t x);
+      void Add(TString s);
+      void Add(TH1* h); //  Binning, contents, errors and style
+      void AddBins(TH1* h); //  Contents and errors only
+      void Add(TGraph* g);  //  Points, errors and style
+      void Add(TF1* f); //  Range, parameters and style (a compiled function can change without trace)
+      template <class T> void AddStyle(const T* o);
+    };
+
+    //  Fingerprint of the name, the log settings and everything the Plotting class holds. The classes add their own members
+    Fingerprint BaseFingerprint(TString name, Int_t logs);
+
+    //  True if a cache index is set, no book is open, the plot is not a panel of a PlottingGrid and it is written to files only
+    Bool_t CacheActive();
+
+    //  True if every file of OutputFiles(name) was written with this fingerprint and was not changed since. Counts the hits and misses
+    Bool_t CacheHit(TString name, const Fingerprint &fp);
+
+    //  Add the just written files to the cache index. With SetAsyncOutput this is queued behind the files
+    void CacheStore(TString name, const Fingerprint &fp);
+    static void CacheStoreFiles(const std::vector<TString> &files, ULong64_t fingerprint);
+
+    //  The files Export() writes for name (besides the book page)
+    std::vector<TString> OutputFiles(TString name);
+
+    //  Objects that only live for a single Plot() (frames, legends, pads, ...). They are deleted in reverse order by CleanUp() at the end of every Plot()
+    std::vector<TObject*> PlotObjects;
+
+    //  Number of contours of a hist of the caller that is drawn on the Canvas. The hist only gets it while Export() paints it,
+    //  so the same hist can be plotted from several threads (and with different contours) and keeps its own contours
+    struct ContourSetting{
+      TH1 *hist;
+      Int_t contours;
+    };
+    std::vector<ContourSetting> Contours;  //  Cleared by CleanUp() like the PlotObjects
+
+    //  Sets the contours on their hists and gives the hists their previous contours back when it goes out of scope. Needs the OutputMutex
+    class ContourGuard{
+      public:
+        ContourGuard(const std::vector<ContourSetting> &contours);
+        ~ContourGuard();
+      private:
+        struct Previous{
+          TH1 *hist;
+          Bool_t user; //  Levels set by the user (kUserContour) are restored as they were, otherwise ROOT computes them while painting
+          std::vector<Double_t> levels;
+        };
+        std::vector<Previous> previous;
+    };
+
+    //  State of the profiling (see EnableProfiling)
+    static std::atomic<Bool_t> Profiling;
+    static std::mutex ProfileMutex;  //  Guards Profiles, QueuedProfiles and QueuedBytes
+    static std::vector<PlotProfile> Profiles;
+    PlotProfile LastProfile;
+
+    //  The writer and the Profiler finish in any order: whichever comes second adds the written bytes to the stored profile
+    static std::atomic<Long64_t> ProfileCounter;  //  Numbers the profiled Plot() calls
+    static std::map<Long64_t, size_t> QueuedProfiles; //  Index in Profiles of the stored profiles whose files are not written yet
+    static std::map<Long64_t, Long64_t> QueuedBytes;  //  Bytes written for profiles that are not stored yet
+    Long64_t ProfileId = 0; //  Number of the running Plot() if it is profiled, 0 otherwise
+    Bool_t ProfileQueued = false; //  The running Plot() handed its files to the writer
+
+    //  Called by the writer after writing the files of the profiled Plot() id
+    static void StoreQueuedBytes(Long64_t id, const std::vector<TString> &files);
+
+    //  0 if the file does not exist
+    static Long64_t FileSize(TString file);
+
+    //  Created first in every Plot(). It times the phases one after the other and stores the profile when Plot() is left (also by an early return or Abort()).
+    //  Without profiling and in the panels of a PlottingGrid (the grid stores one profile for all of them) it does nothing
+    class Profiler{
+      public:
+        Profiler(Plotting *plotting, TString plotclass, TString name);
+        ~Profiler();
+
+        //  End the running phase and start phase (a phase can be entered several times, its times add up)
+        void Phase(ProfilePhase phase);
+        void Result(TString result);
+
+        //  Count a drawn object with its bins or points
+        void Count(TH1* h);
+        void Count(TGraph* g);
+        void Count(TF1* f);
+        void Count(Int_t objects);
+
+      private:
+        Plotting *P;
+        Bool_t Active;
+        Long64_t Id = 0;
+        Bool_t Exported = false;
+        Int_t Running = kInputPhase;
+        std::chrono::steady_clock::time_point Start;
+        PlotProfile Profile;
+    };
+
+    //  Objects given as file and key to a New.. function. The New.. function puts a placeholder into hists, graphs, .. and the object is read through
+    //  PlottingFileCache when the first Plot() starts. resolve then puts a copy of it into the place of the placeholder and styles it
+    struct LazyObject{
+      TString file;
+      TString key;
+      std::function<void(TObject*)> resolve;
+    };
+    std::vector<LazyObject> LazyObjects;
+    std::vector<std::shared_ptr<TObject>> LoadedObjects;  //  The copies of the read objects that this plotting object styles and draws
+
+    //  Read all LazyObjects. Called first in every Plot()
+    void ResolveLazy();
+
+    //  ResolveLazy, ComputeStacks and ComputeBands: everything the axis ranges depend on. Called first in every Plot(), for the panels of a PlottingGrid
+    //  once by the grid before it shares the ranges and not again by the panel
+    virtual void Prepare();
+
+    //  Put a placeholder for the 1D hist or graph key in file into objects (with its DrawOpt in options). ResolveLazy replaces it by the object,
+    //  styled like the objects given directly to a New.. function with the auto style number count
+    template <class T> void NewLazy(TString file, TString key, std::vector<T*> &objects, const std::vector<DrawOpt> &options, Int_t count,
+                                    TString label, Int_t style, Int_t size, Int_t color);
+
+    //  A band added by NewBand. It is computed by every Plot() (so it follows refilled hists) into hists owned by the plotting object.
+    //  They hold the middle of the band with half its width as error and are drawn with "E2". The buffers keep their size between Plot() calls
+    struct ComputedBand{
+      TH1 *nominal;
+      std::vector<TH1*> variations;
+      BandMode mode;
+      TH1D *band; //  In hists
+      TH1D *ratio = nullptr;  //  The band divided by the nominal, in the ratios of PlottingRatio
+      std::vector<Double_t> nom, low, up, content;
+    };
+    std::vector<ComputedBand> ComputedBands;
+
+    //  A stack added by NewStack. Every Plot() sums its components up into hists owned by the plotting object, layer i holds the sum of the components 0..i.
+    //  The layers are drawn filled from the total down, so each one covers the lower part of the one before and only its own component stays visible
+    struct ComputedStack{
+      std::vector<TH1*> components;
+      std::vector<TH1D*> layers;  //  In hists, from the last to the first
+      std::vector<Double_t> sum, error2;  //  The running sums of contents and squared errors, their size is kept between Plot() calls
+    };
+    std::vector<ComputedStack> ComputedStacks;
+
+    //  Check the components of a stack and create its layers
+    ComputedStack NewComputedStack(const std::vector<TH1*> &components);
+
+    //  Give a stack layer its fill after it was styled like a hist
+    static void StyleLayer(TH1D* h);
+
+    //  Fill the layers of a stack with one prefix sum over the bin arrays of the components
+    void ComputeStack(ComputedStack &stack);
+
+    //  ComputeStack for all ComputedStacks (called first in every Plot(), before the bands and ratios that can use the totals)
+    void ComputeStacks();
+
+    //  Give h the binning of reference, if they differ (e.g. reference was rebinned). h keeps its sumw2 array
+    static void FollowBinning(TH1D* h, TH1* reference);
+
+    //  Check the inputs of a band and create its hists (the ratio only if ratio is set)
+    ComputedBand NewComputedBand(TH1* nominal, const std::vector<TH1*> &variations, BandMode mode, Bool_t ratio);
+
+    //  Give a band hist its fill (the theme color of its line, translucent) after it was styled like a hist
+    static void StyleBand(TH1D* h);
+
+    //  Fill all ComputedBands from the current contents of their inputs (called first in every Plot())
+    void ComputeBands();
+
+    //  Widen low and up by one variation of nominal nom. One pass over contiguous arrays without branches, so it vectorizes
+    template <Int_t Mode, typename T> static void BandKernel(const T* v, const Double_t* nom, Double_t* low, Double_t* up, Int_t nbins);
+
+    //  Write the band [low*scale, up*scale] into the bin and sumw2 arrays of h and store its extrema, so the axis ranges include the whole band.
+    //  scale 0 gives an empty bin
+    static void FillBand(TH1D* h, const std::vector<Double_t> &low, const std::vector<Double_t> &up, const std::vector<Double_t> &scale);
+
+    //  Hand a per-plot object to PlotObjects and return it
+    template <class T> T* Own(T* obj);
+
+    //  Delete all PlotObjects and the Canvas, so the same plotting object can be plotted again without leaking. Does nothing while HostPad is set
+    void CleanUp();
+
+    //  Canvas for a Plot(): a new canvas of w x h pixels or the HostPad
+    TPad* NewCanvas(Int_t w, Int_t h);
+
+    //  Called by PlottingGrid after the grid is written: forget the HostPad (it belongs to the grid) and clean up
+    void ReleaseHost();
+
+    //  Copy UserAxisRange back into AxisRange, so AutoSetAxisRanges sets the same borders again
+    void ResetAxisRange();
+
+    //  Append a process-wide unique number to name, so objects of different plots never share a name
+    static TString UniqueName(TString name);
 
     //  Create the legend leg using LegendBorders that will be drawn in Plot()
     void InitializeLegend();
 
-    //  Adjusts the x and y axis range depending on the histograms that will be drawn
+    //  Create an axis frame with a single bin, so only the axes (and no bin storage) are allocated. It is not added to gDirectory.
+    TH2D* NewFrame(TString name, Double_t xlow, Double_t xup, Double_t ylow, Double_t yup);
+
+    //  Paint whatever drawData draws into the frame [xlow,xup]x[ylow,yup] of an offscreen canvas with RasterDPI and show the bitmap inside the frame of Canvas.
+    //  drawData gets the factor by which marker sizes and line widths have to be scaled to look like on Canvas. The caller redraws the axes on top.
+    void RasterizeFrame(Double_t xlow, Double_t xup, Double_t ylow, Double_t yup, Bool_t logx, Bool_t logy, Bool_t logz, const std::function<void(Double_t)> &drawData);
+
+    //  Adjusts the x and y axis range depending on the histograms, graphs and functions that will be drawn
     void AutoSetAxisRanges(Bool_t logy);
 
-    //  When encountering NULL pointers or other errors, exit(0) with a short error Message
-    void Abort(TString Message);
+    //  True if an AxisRange border is still set to 42 and should be autoset
+    static Bool_t IsAutoRange(Double_t border);
+
+    //  Smallest, largest and smallest positive (for log axes) value of an object in the visible x window and its x extent in that window
+    struct Extrema{
+      Double_t min = std::numeric_limits<Double_t>::infinity();
+      Double_t max = -std::numeric_limits<Double_t>::infinity();
+      Double_t minpos = std::numeric_limits<Double_t>::infinity();
+      Double_t xmin = std::numeric_limits<Double_t>::infinity();
+      Double_t xmax = -std::numeric_limits<Double_t>::infinity();
+      void Merge(const Extrema &other);
+    };
+
+    //  The last scan of each function. It is reused as long as the signature (window, parameters) did not change, so a re-plot does not sample it again
+    struct CachedExtrema{
+      std::vector<Double_t> signature;
+      Extrema extrema;
+    };
+    std::map<const TObject*, CachedExtrema> ExtremaCache;
+
+    //  Single pass scans of the visible x window [xlow,xup] (infinite borders for everything)
+    Extrema ScanHist(TH1* h, Double_t xlow, Double_t xup);  //  Always rescanned, a key that sees every change of the bins would read them all and cost more than the scan
+    Extrema ScanGraph(TGraph* g, Double_t xlow, Double_t xup);  //  Includes the error bars. Graphs are always rescanned, since points can be changed without any trace
+    Extrema ScanFunc(TF1* f, Double_t xlow, Double_t xup);  //  Samples the function at GetNpx() points
+
+    //  Calls kernel with the bin content array of h, if the type of h stores its bin contents directly (TH1F, TH1D, TH1I, ...). Returns false otherwise (e.g. TProfile)
+    template <class Kernel> static Bool_t VisitBinArray(TH1* h, Kernel&& kernel);
+
+    //  The fused min/max/positive-min loops. They are written without branches so the compiler can vectorize them
+    template <typename T> static void HistExtremaKernel(const T* content, Int_t first, Int_t last, Extrema &e);
+    template <Bool_t HasEX, Bool_t HasEY> static void GraphExtremaKernel(const Double_t* x, const Double_t* y, const Double_t* exl, const Double_t* exh,
+                                                                         const Double_t* eyl, const Double_t* eyh, Int_t n, Double_t xlow, Double_t xup, Extrema &e);
+
+    //  When encountering NULL pointers or other errors, exit(1) with a short error Message (or throw it, see SetThrowOnAbort)
+    static void Abort(TString Message);
 
     //  Converts the given DrawOptions to good parametes for the legend reference symbols
-    TString LegendDrawOption(TString DrawOpt);
+    static TString LegendDrawOption(TString DrawOpt);
+
+    //  Save the drawn Canvas as name in all Formats and add it as a page to the open book. A palette >= 0 is set in gStyle right before writing.
+    //  With SetAsyncOutput the Canvas is handed to the writer (see DetachScene) and Canvas is 0 afterwards
+    void Export(TString name, Int_t palette = -1);
+
+    //  Print canvas as a page of book (if not empty) and save it as files. Locks the OutputMutex
+    static void WriteCanvas(TPad* canvas, TString name, const std::vector<TString> &files, TString book, Int_t palette);
+
+    //  Encode the Canvas as files into OutputBuffers (see SetMemoryOutput)
+    void EncodeCanvas(const std::vector<TString> &files);
+
+    //  The name of the object that SetOutputDirectory writes for the plot name
+    static TString ObjectName(TString name);
+
+    //  Take the PlotObjects and replace every other object drawn on the Canvas (and in its legends) by a copy. Returns everything the writer has to delete
+    std::vector<TObject*> DetachScene();
 
 };
 
+TString Plotting::BookName = "";
+Int_t Plotting::BookPages = 0;
+std::recursive_mutex Plotting::OutputMutex;
+std::atomic<Int_t> Plotting::NameCounter(0);
+Bool_t Plotting::ThrowOnAbort = false;
+std::atomic<Int_t> Plotting::AsyncQueueSize(0);
+std::mutex Plotting::QueueMutex;
+std::condition_variable Plotting::QueueChanged;
+std::deque<std::function<void()>> Plotting::Queue;
+Bool_t Plotting::Writing = false;
+std::vector<TString> Plotting::OutputErrors;
+std::thread Plotting::Writer;
+TString Plotting::CacheIndex = "";
+std::map<TString, Plotting::CacheEntry> Plotting::CacheEntries;
+std::atomic<Int_t> Plotting::CacheHits(0);
+std::atomic<Int_t> Plotting::CacheMisses(0);
+std::atomic<Bool_t> Plotting::Profiling(false);
+std::mutex Plotting::ProfileMutex;
+std::vector<Plotting::PlotProfile> Plotting::Profiles;
+std::atomic<Long64_t> Plotting::ProfileCounter(0);
+std::map<Long64_t, size_t> Plotting::QueuedProfiles;
+std::map<Long64_t, Long64_t> Plotting::QueuedBytes;
+
 Plotting::Plotting(){
 
 }
 
 Plotting::~Plotting(){
+  CleanUp();
+  for( Int_t i = 0; i < (Int_t)Latex.size(); ++i) delete Latex.at(i);
+  for( Int_t i = 0; i < (Int_t)lines.size(); ++i) delete lines.at(i);
+  for( Int_t i = 0; i < (Int_t)clines.size(); ++i) delete clines.at(i);
+  for( Int_t i = 0; i < (Int_t)ComputedBands.size(); ++i){
+    delete ComputedBands.at(i).band;
+    delete ComputedBands.at(i).ratio;
+  }
+  for( Int_t i = 0; i < (Int_t)ComputedStacks.size(); ++i){
+    for( Int_t k = 0; k < (Int_t)ComputedStacks.at(i).layers.size(); ++k) delete ComputedStacks.at(i).layers.at(k);
+  }
+  for(auto &samples : SampleCache) delete samples.second.graph;
+} //  The hists, graphs and funcs belong to the user and are not deleted
+
+template <class T> T* Plotting::Own(T* obj){
+  PlotObjects.push_back(obj);
+  return obj;
+}
+
+void Plotting::CleanUp(){
+  if(HostPad) return; //  The grid is not written yet
+  //  Reverse order, so objects are deleted before the pads they were drawn on
+  for( Int_t i = (Int_t)PlotObjects.size() - 1; i >= 0; --i) delete PlotObjects.at(i);
+  PlotObjects.clear();
+  Contours.clear();
+  delete Canvas;
+  Canvas = nullptr;
+  hDummy = nullptr;
+  leg = nullptr;
+  SceneChanged = true;  //  Nothing is drawn anymore
+  ResetAxisRange();
+}
+
+void Plotting::ResolveLazy(){
+  for( Int_t i = 0; i < (Int_t)LazyObjects.size(); ++i){
+    TString error = "";
+    std::shared_ptr<TObject> object = PlottingFileCache::Get(LazyObjects.at(i).file, LazyObjects.at(i).key, error);
+    if(!object) Abort(error);
+    //  The cached object is shared by every plotting object that reads the same key, so each one styles (and changes axis ranges of) its own copy
+    TDirectory::TContext NoDirectory(nullptr);
+    LoadedObjects.emplace_back(object->Clone());
+    LazyObjects.at(i).resolve(LoadedObjects.back().get());
+  }
+  LazyObjects.clear();
+}
+
+void Plotting::Prepare(){
+  ResolveLazy(); //  Read the objects given by file and key
+  ComputeStacks();  //  From the current contents of their inputs
+  ComputeBands();
+}
+
+template <class T> void Plotting::NewLazy(TString file, TString key, std::vector<T*> &objects, const std::vector<DrawOpt> &options, Int_t count,
+                                          TString label, Int_t style, Int_t size, Int_t color){
+  Int_t index = objects.size();
+  objects.push_back(nullptr); //  Placeholder until Plot() reads the object
+  LazyObjects.push_back({file, key, [this, &objects, &options, index, count, file, key, label, style, size, color](TObject *o){
+    T *obj = dynamic_cast<T*>(o);
+    TH1 *h = dynamic_cast<TH1*>(o);
+    if(!obj || (h && h->GetDimension() != 1)) Abort(Form("%s in %s is not a %s.", key.Data(), file.Data(), std::is_same<T, TH1>::value ? "1D hist" : "graph"));
+    if(h) h->SetStats(0);
+    objects.at(index) = obj;
+    //  LineStyles > 10 make root crash. If its not drawn in hist style, the errors are the only lines and should be style 1
+    ApplyStyle(obj, count, label, style, size, color, (options.at(index).line && style < 10 && style != -1) ? style : 1);
+  }});
+}
 
+void Plotting::FollowBinning(TH1D* h, TH1* reference){
+  const Int_t nbins = reference->GetNbinsX();
+  if(h->GetNbinsX() == nbins && h->GetBinLowEdge(1) == reference->GetBinLowEdge(1) && h->GetBinLowEdge(nbins + 1) == reference->GetBinLowEdge(nbins + 1)) return;
+  std::vector<Double_t> edges;
+  for( Int_t i = 1; i <= nbins + 1; ++i) edges.push_back(reference->GetBinLowEdge(i));
+  h->SetBins(nbins, edges.data());
+  h->Sumw2(kFALSE);
+  h->Sumw2();
+}
+
+Plotting::ComputedStack Plotting::NewComputedStack(const std::vector<TH1*> &components){
+
+  if(components.size() < 1) Abort("NewStack was given no hists.");
+  for( Int_t i = 0; i < (Int_t)components.size(); ++i){
+    if(!components.at(i)) Abort("NewStack was given a Nullptr.");
+    if(components.at(i)->GetDimension() != 1) Abort("NewStack was given a hist with more than one dimension.");
+  }
+
+  ComputedStack stack;
+  stack.components = components;
+  TDirectory::TContext NoDirectory(nullptr);
+  for( Int_t i = 0; i < (Int_t)components.size(); ++i){
+    stack.layers.push_back(new TH1D(UniqueName("Layer"), "", 1, 0, 1));  //  Gets the binning of the components in ComputeStack
+    stack.layers.back()->Sumw2();
+  }
+  return stack;
+}
+
+void Plotting::StyleLayer(TH1D* h){
+  h->SetFillColor(h->GetLineColor());
+  h->SetFillStyle(1001);
+}
+
+void Plotting::ComputeStack(ComputedStack &stack){
+  const Int_t nbins = stack.components.front()->GetNbinsX();
+  stack.sum.assign(nbins, 0.);
+  stack.error2.assign(nbins, 0.);
+
+  for( Int_t k = 0; k < (Int_t)stack.components.size(); ++k){
+    TH1 *h = stack.components.at(k);
+    if(h->GetNbinsX() != nbins) Abort(Form("NewStack was given %s with %d bins, but %s has %d.", h->GetName(), h->GetNbinsX(), stack.components.front()->GetName(), nbins));
+    Double_t *sum = stack.sum.data();
+    Double_t *error2 = stack.error2.data();
+
+    //  Without sumw2 the errors are sqrt(content), as in TH1::GetBinError. Index 0 of the arrays is the underflow
+    const Double_t *sumw2 = h->GetSumw2N() ? h->GetSumw2()->GetArray() : nullptr;
+    Bool_t direct = VisitBinArray(h, [&](const auto* c){
+      for( Int_t i = 0; i < nbins; ++i){
+        sum[i] += c[i+1];
+        error2[i] += sumw2 ? sumw2[i+1] : TMath::Abs((Double_t)c[i+1]);
+      }
+    });
+    if(!direct){
+      for( Int_t i = 0; i < nbins; ++i){  //  Profiles calculate their contents and errors
+        sum[i] += h->GetBinContent(i+1);
+        error2[i] += h->GetBinError(i+1) * h->GetBinError(i+1);
+      }
+    }
+
+    TH1D *layer = stack.layers.at(k);
+    FollowBinning(layer, stack.components.front());
+    std::copy(stack.sum.begin(), stack.sum.end(), layer->GetArray() + 1);
+    std::copy(stack.error2.begin(), stack.error2.end(), layer->GetSumw2()->GetArray() + 1);
+  }
+}
+
+void Plotting::ComputeStacks(){
+  for( Int_t i = 0; i < (Int_t)ComputedStacks.size(); ++i) ComputeStack(ComputedStacks.at(i));
+}
+
+Plotting::ComputedBand Plotting::NewComputedBand(TH1* nominal, const std::vector<TH1*> &variations, BandMode mode, Bool_t ratio){
+
+  if(!nominal) Abort("NewBand was given a Nullptr.");
+  if(nominal->GetDimension() != 1) Abort("NewBand was given a hist with more than one dimension.");
+  if(variations.size() < 1) Abort("NewBand was given no variations.");
+  for( Int_t i = 0; i < (Int_t)variations.size(); ++i){
+    if(!variations.at(i)) Abort("NewBand was given a Nullptr.");
+    if(variations.at(i)->GetDimension() != 1) Abort("NewBand was given a hist with more than one dimension.");
+  }
+
+  ComputedBand b;
+  b.nominal = nominal;
+  b.variations = variations;
+  b.mode = mode;
+  {
+    TDirectory::TContext NoDirectory(nullptr);
+    b.band = new TH1D(UniqueName("Band"), "", 1, 0, 1);  //  Gets the binning of the nominal in ComputeBands
+    if(ratio) b.ratio = new TH1D(UniqueName("BandRatio"), "", 1, 0, 1);
+  }
+  b.band->Sumw2();
+  if(b.ratio) b.ratio->Sumw2();
+  return b;
+}
+
+void Plotting::StyleBand(TH1D* h){
+  h->SetFillColorAlpha(h->GetLineColor(), 0.35);
+  h->SetFillStyle(1001);
+  h->SetMarkerSize(0);  //  Only the boxes of "E2"
+}
+
+template <Int_t Mode, typename T> void Plotting::BandKernel(const T* v, const Double_t* nom, Double_t* low, Double_t* up, Int_t nbins){
+  for( Int_t i = 0; i < nbins; ++i){
+    const Double_t x = v[i];
+    if(Mode == kEnvelope){
+      low[i] = std::min(low[i], x);
+      up[i] = std::max(up[i], x);
+    }
+    if(Mode == kQuadrature){
+      const Double_t d = x - nom[i];
+      const Double_t down = std::min(d, 0.);
+      const Double_t upward = std::max(d, 0.);
+      low[i] += down * down;
+      up[i] += upward * upward;
+    }
+  }
+}
+
+void Plotting::FillBand(TH1D* h, const std::vector<Double_t> &low, const std::vector<Double_t> &up, const std::vector<Double_t> &scale){
+  const Int_t nbins = low.size();
+  Double_t *c = h->GetArray() + 1;  //  Skip the underflow
+  Double_t *e2 = h->GetSumw2()->GetArray() + 1;
+  Double_t min = std::numeric_limits<Double_t>::infinity();
+  Double_t max = -std::numeric_limits<Double_t>::infinity();
+  for( Int_t i = 0; i < nbins; ++i){
+    const Double_t l = low[i] * scale[i];
+    const Double_t u = up[i] * scale[i];
+    const Double_t half = 0.5 * (u - l);
+    c[i] = 0.5 * (u + l);
+    e2[i] = half * half;
+    min = std::min(min, std::min(l, u));
+    max = std::max(max, std::max(l, u));
+  }
+  //  ScanHist only looks at the contents (the middle of the band), the stored extrema make the axes cover its edges
+  h->SetMinimum(nbins ? min : -1111);
+  h->SetMaximum(nbins ? max : -1111);
+}
+
+void Plotting::ComputeBands(){
+  for( Int_t k = 0; k < (Int_t)ComputedBands.size(); ++k){
+    ComputedBand &b = ComputedBands.at(k);
+    const Int_t nbins = b.nominal->GetNbinsX();
+
+    //  The nominal can have been rebinned since the last Plot()
+    FollowBinning(b.band, b.nominal);
+    if(b.ratio) FollowBinning(b.ratio, b.nominal);
+
+    b.nom.resize(nbins);
+    b.content.resize(nbins);
+    for( Int_t i = 0; i < nbins; ++i) b.nom[i] = b.nominal->GetBinContent(i + 1);
+    if(b.mode == kEnvelope){
+      b.low = b.nom;
+      b.up = b.nom;
+    }
+    else{
+      b.low.assign(nbins, 0.);
+      b.up.assign(nbins, 0.);
+    }
+
+    for( Int_t v = 0; v < (Int_t)b.variations.size(); ++v){
+      TH1 *h = b.variations.at(v);
+      if(h->GetNbinsX() != nbins) Abort(Form("NewBand was given the variation %s with %d bins, but its nominal has %d.", h->GetName(), h->GetNbinsX(), nbins));
+      //  Index 0 of the arrays is the underflow
+      Bool_t direct = VisitBinArray(h, [&](const auto* c){
+        if(b.mode == kEnvelope) BandKernel<kEnvelope>(c + 1, b.nom.data(), b.low.data(), b.up.data(), nbins);
+        else BandKernel<kQuadrature>(c + 1, b.nom.data(), b.low.data(), b.up.data(), nbins);
+      });
+      if(direct) continue;
+      for( Int_t i = 0; i < nbins; ++i) b.content[i] = h->GetBinContent(i + 1); //  Profiles calculate their contents
+      if(b.mode == kEnvelope) BandKernel<kEnvelope>(b.content.data(), b.nom.data(), b.low.data(), b.up.data(), nbins);
+      else BandKernel<kQuadrature>(b.content.data(), b.nom.data(), b.low.data(), b.up.data(), nbins);
+    }
+
+    if(b.mode == kQuadrature){
+      for( Int_t i = 0; i < nbins; ++i){
+        b.low[i] = b.nom[i] - std::sqrt(b.low[i]);
+        b.up[i] = b.nom[i] + std::sqrt(b.up[i]);
+      }
+    }
+
+    b.content.assign(nbins, 1.);
+    FillBand(b.band, b.low, b.up, b.content);
+    if(!b.ratio) continue;
+    for( Int_t i = 0; i < nbins; ++i) b.content[i] = b.nom[i] != 0 ? 1. / b.nom[i] : 0.; //  Bins with an empty nominal stay empty
+    FillBand(b.ratio, b.low, b.up, b.content);
+  }
+}
+
+TPad* Plotting::NewCanvas(Int_t w, Int_t h){
+  if(!HostPad) return new TCanvas(UniqueName("Canvas"), "Canvas", w, h);
+  HostPad->cd();
+  return HostPad;
+}
+
+void Plotting::ReleaseHost(){
+  if(Canvas == HostPad) Canvas = nullptr;
+  HostPad = nullptr;
+  CleanUp();
+}
+
+void Plotting::ResetAxisRange(){
+  for( Int_t i = 0; i < 3; ++i){
+    AxisRange[i][0] = UserAxisRange[i][0];
+    AxisRange[i][1] = UserAxisRange[i][1];
+  }
+}
+
+void Plotting::SetPersistent(Bool_t persistent){
+  Persistent = persistent;
+  if(!Persistent && Canvas) CleanUp();
+}
+
+void Plotting::AppendSignature(std::vector<Double_t> &signature, TH1* h){
+  //  Bins can be changed without a trace in the entries or stored sums (AddBinContent, SetBinError, SetBinContent after SetEntries), so the arrays are hashed.
+  //  The hash is split into two exact halves, a Double_t holds only 53 bits
+  Fingerprint fp;
+  fp.AddBins(h);
+  signature.insert(signature.end(), {(Double_t)h->GetNcells(), (Double_t)(fp.hash >> 32), (Double_t)(fp.hash & 0xFFFFFFFFULL), h->GetMaximumStored(), h->GetMinimumStored()});
+}
+
+void Plotting::AppendSignature(std::vector<Double_t> &signature, TGraph* g){
+  //  Graphs store no statistics, so the points have to be summed. This is still much cheaper than painting them
+  Double_t sumx = 0, sumy = 0;
+  const Double_t *x = g->GetX();
+  const Double_t *y = g->GetY();
+  for( Int_t i = 0; i < g->GetN(); ++i){
+    sumx += x[i];
+    sumy += y[i];
+  }
+  signature.insert(signature.end(), {(Double_t)g->GetN(), sumx, sumy});
+}
+
+void Plotting::AppendSignature(std::vector<Double_t> &signature, TF1* f){
+  signature.insert(signature.end(), {f->GetXmin(), f->GetXmax(), (Double_t)f->GetNpx()});
+  for( Int_t i = 0; i < f->GetNpar(); ++i) signature.push_back(f->GetParameter(i));
+}
+
+std::vector<Double_t> Plotting::DataSignature(){
+  std::vector<Double_t> signature;
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i) AppendSignature(signature, hists.at(i));
+  for( Int_t i = 0; i < (Int_t)graphs.size(); ++i) AppendSignature(signature, graphs.at(i));
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i) AppendSignature(signature, funcs.at(i));
+  return signature;
+}
+
+void Plotting::KeepScene(TString name, Int_t logs, std::vector<Double_t> signature){
+  SceneChanged = false;
+  LastName = name;
+  LastLogs = logs;
+  LastSignature = signature;
 }
 
 //  The following 3 functions simply copy the user given settings into attributes of the Plotting class
 void Plotting::SetMargins(Double_t low, Double_t left, Double_t up, Double_t right, Int_t cw, Int_t ch){
+  SceneChanged = true;
   CanvasMargins[0][0] = left;
   CanvasMargins[0][1] = right;
   CanvasMargins[1][0] = low;
@@ -130,125 +1638,1197 @@ void Plotting::SetMargins(Double_t low, Double_t left, Double_t up, Double_t rig
   CanvasDimensions[1] = ch;
 } //  These parameters will be used when Plot() calls InitializeCanvas
 
-void Plotting::SetAxisRange(Double_t xlow, Double_t xup, Double_t ylow, Double_t yup, Double_t zlow, Double_t zup){
-  AxisRange[0][0] = xlow;
-  AxisRange[0][1] = xup;
-  AxisRange[1][0] = ylow;
-  AxisRange[1][1] = yup;
-  AxisRange[2][0] = zlow; //  Not used in Plotting 1D
-  AxisRange[2][1] = zup;  // In PlottingRatio this gives the range of the ratio
-} //  These parameters will be used when Plot() calls InitializeAxis
+void Plotting::SetAxisRange(Double_t xlow, Double_t xup, Double_t ylow, Double_t yup, Double_t zlow, Double_t zup){
+  UserAxisRange[0][0] = xlow;
+  UserAxisRange[0][1] = xup;
+  UserAxisRange[1][0] = ylow;
+  UserAxisRange[1][1] = yup;
+  UserAxisRange[2][0] = zlow; //  Not used in Plotting 1D
+  UserAxisRange[2][1] = zup;  // In PlottingRatio this gives the range of the ratio
+  ResetAxisRange();
+  SceneChanged = true;
+} //  These parameters will be used when Plot() calls InitializeAxis
+
+void Plotting::SetLegend(Double_t x1, Double_t x2, Double_t y1, Double_t y2){
+  SceneChanged = true;
+  LegendBorders[0][0] = x1;
+  LegendBorders[0][1] = x2;
+  LegendBorders[1][0] = y1;
+  LegendBorders[1][1] = y2;
+} //  These parameters will be used when Plot() calls InitializeLegend
+
+void Plotting::SetMemoryOutput(Bool_t memory){
+  SceneChanged = true;
+  MemoryOutput = memory;
+  if(!MemoryOutput) OutputBuffers.clear();
+}
+
+Bool_t Plotting::TakeOutput(TString file, std::string &buffer){
+  auto output = OutputBuffers.find(file);
+  if(output == OutputBuffers.end()) return false;
+  buffer.swap(output->second);
+  OutputBuffers.erase(output);
+  return true;
+}
+
+void Plotting::SetOutputDirectory(TDirectory *directory){
+  SceneChanged = true;
+  OutputDirectory = directory;
+}
+
+void Plotting::SetFormats(TString formats){
+  SceneChanged = true;  //  A persistent plot has to write the new formats even under the same name
+  Formats.clear();
+  TObjArray *formatStr = formats.Tokenize(";");  //  The semicolon seperates the different formats
+  for(Int_t i = 0; i < formatStr->GetEntries(); i++){
+    TString format = ((TObjString*) formatStr->At(i))->GetString();
+    if(format.BeginsWith(".")) format.Remove(0,1);  //  Allow ".pdf" aswell as "pdf"
+    if(format.Length()) Formats.push_back(format);
+  }
+  delete formatStr;
+} //  These formats will be used when Plot() calls Export
+
+void Plotting::OpenBook(TString bookname){
+  CloseBook(); //  Only one book can be open at a time
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+  BookName = bookname;
+  BookPages = 0;
+}
+
+void Plotting::CloseBook(){
+  FlushOutput();  //  Queued pages are printed first
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+  if(!BookName.Length()) return;
+  //  The closing bracket only finalizes the pdf and does not print anything, so any canvas can be used for it
+  if(BookPages > 0){
+    TCanvas *BookCanvas = new TCanvas(UniqueName("BookCanvas"), "BookCanvas", 10, 10);
+    BookCanvas->Print(BookName + "]");
+    delete BookCanvas;
+  }
+  BookName = "";
+  BookPages = 0;
+}
+
+void Plotting::EnableThreadSafety(){
+  ROOT::EnableThreadSafety(); //  Makes gPad and gDirectory thread local and protects ROOTs internal lists
+  gROOT->SetBatch(kTRUE); //  Canvases can only be created concurrently when they are not shown on screen
+}
+
+void Plotting::SetAsyncOutput(Int_t queuesize){
+  if(queuesize < 1){
+    FlushOutput();
+    StopWriter();
+    return;
+  }
+  static Bool_t registered = false;
+  if(!registered) std::atexit(StopWriter); //  Runs before ROOT is torn down, because ROOT registered its cleanup earlier
+  registered = true;
+  EnableThreadSafety();
+  std::lock_guard<std::mutex> lock(QueueMutex);
+  AsyncQueueSize = queuesize;
+  if(!Writer.joinable()) Writer = std::thread(WriteQueue);
+  QueueChanged.notify_all();  //  A larger queue lets waiting plots continue
+}
+
+void Plotting::FlushOutput(){
+  WaitForWriter();
+  TString errors = TakeOutputErrors();
+  if(errors.Length()) Abort(errors);
+}
+
+void Plotting::WriteQueue(){
+  std::unique_lock<std::mutex> lock(QueueMutex);
+  while(true){
+    QueueChanged.wait(lock, []{ return Queue.size() > 0 || AsyncQueueSize == 0; });
+    if(Queue.empty()) return;
+    std::function<void()> job = std::move(Queue.front());
+    Queue.pop_front();
+    Writing = true;
+    QueueChanged.notify_all();  //  There is space for the next plot
+    lock.unlock();
+    TString error = "";
+    try{
+      job();
+    }
+    catch(const std::exception &e){
+      error = e.what();
+    }
+    lock.lock();
+    if(error.Length()) OutputErrors.push_back(error);
+    Writing = false;
+    QueueChanged.notify_all();
+  }
+}
+
+void Plotting::Enqueue(std::function<void()> job){
+  std::unique_lock<std::mutex> lock(QueueMutex);
+  QueueChanged.wait(lock, []{ return (Int_t)Queue.size() < std::max(1, (Int_t)AsyncQueueSize); });
+  Queue.push_back(std::move(job));  //  Queued even if an earlier job failed, it owns the canvas or image
+  QueueChanged.notify_all();
+  lock.unlock();
+  TString errors = TakeOutputErrors();
+  if(errors.Length()) Abort(errors);
+}
+
+void Plotting::WaitForWriter(){
+  std::unique_lock<std::mutex> lock(QueueMutex);
+  QueueChanged.wait(lock, []{ return Queue.empty() && !Writing; });
+}
+
+void Plotting::StopWriter(){
+  {
+    std::lock_guard<std::mutex> lock(QueueMutex);
+    AsyncQueueSize = 0;
+    QueueChanged.notify_all();
+  }
+  if(Writer.joinable()) Writer.join(); //  The writer finishes the queue first
+  TString errors = TakeOutputErrors();
+  if(errors.Length()) cerr << errors << endl; //  Nobody is left to report them to
+}
+
+TString Plotting::TakeOutputErrors(){
+  std::lock_guard<std::mutex> lock(QueueMutex);
+  TString errors = "";
+  for( Int_t i = 0; i < (Int_t)OutputErrors.size(); ++i) errors += (i ? " " : "") + OutputErrors.at(i);
+  OutputErrors.clear();
+  return errors;
+}
+
+TString Plotting::UniqueName(TString name){
+  return TString::Format("%s_%d", name.Data(), NameCounter++);
+}
+
+std::vector<TString> Plotting::OutputFiles(TString name){
+  std::vector<TString> files;
+  if(!name.Length()) return files;
+  if(Formats.size() < 1){
+    files.push_back(name);
+    return files;
+  }
+  //  Strip the extension (if given), there is one file per format
+  TString stem = name;
+  if(stem.Last('.') > stem.Last('/')) stem.Remove(stem.Last('.'));
+  for(Int_t i = 0; i < (Int_t)Formats.size(); ++i) files.push_back(stem + "." + Formats.at(i));
+  return files;
+}
+
+void Plotting::Export(TString name, Int_t palette){
+
+  if(HostPad) return; //  The grid writes the canvas with all its panels
+
+  std::vector<TString> files = OutputFiles(name);
+  TString book = BookName;
+  if(AsyncQueueSize == 0 || Persistent || MemoryOutput || OutputDirectory){
+    WaitForWriter(); //  Earlier pages of the book are printed first
+    std::lock_guard<std::recursive_mutex> lock(OutputMutex);  //  Keeps the palette until the buffers and the object are written
+    ContourGuard contours(Contours);
+    WriteCanvas(Canvas, name, MemoryOutput ? std::vector<TString>() : files, book, palette);
+    if(MemoryOutput) EncodeCanvas(files);
+    if(OutputDirectory && name.Length()){
+      TDirectory::TContext context(OutputDirectory);
+      Canvas->Write(ObjectName(name), TObject::kOverwrite);
+    }
+    return;
+  }
+
+  //  The writer owns the canvas from now on. CleanUp finds nothing left to delete
+  TPad *canvas = Canvas;
+  std::vector<TObject*> objects;
+  {
+    std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+    ContourGuard contours(Contours); //  The copies of the hists keep the contours
+    objects = DetachScene();
+  }
+  Canvas = nullptr;
+  Long64_t profile = ProfileId;
+  ProfileQueued = true;
+  Enqueue([=](){
+    for( Int_t i = 0; i < (Int_t)files.size(); ++i) gSystem->Unlink(files.at(i));  //  A file of an earlier Plot() must not pass the check below
+    WriteCanvas(canvas, name, files, book, palette);
+    for( Int_t i = (Int_t)objects.size() - 1; i >= 0; --i) delete objects.at(i);
+    delete canvas;
+    for( Int_t i = 0; i < (Int_t)files.size(); ++i){
+      if(gSystem->AccessPathName(files.at(i))) throw std::runtime_error(Form("Could not write %s.", files.at(i).Data()));
+    }
+    if(profile) StoreQueuedBytes(profile, files);
+  });
+}
+
+void Plotting::WriteCanvas(TPad* canvas, TString name, const std::vector<TString> &files, TString book, Int_t palette){
+
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+  if(palette >= 0) gStyle->SetPalette(palette); //  The palette is global in ROOT and only used while painting
+
+  //  The first page opens the pdf with "(" and keeps it open. All following pages are appended to the same file without reinitializing it.
+  if(book.Length()){
+    canvas->Print(book + (BookPages == 0 ? "(" : ""), Form("Title:%s", name.Length() ? name.Data() : Form("Page %d", BookPages + 1)));
+    BookPages++;
+  }
+
+  //  Save the already drawn Canvas once per format
+  for(Int_t i = 0; i < (Int_t)files.size(); ++i) canvas->SaveAs(files.at(i));
+}
+
+void Plotting::EncodeCanvas(const std::vector<TString> &files){
+  OutputBuffers.clear();
+  TImage *image = nullptr;
+  for( Int_t i = 0; i < (Int_t)files.size(); ++i){
+    const TString &file = files.at(i);
+    if(file.Last('.') <= file.Last('/')) Abort(Form("%s has no format to encode.", file.Data()));
+    TString format = file(file.Last('.') + 1, file.Length());
+    format.ToLower();
+    TImage::EImageFileTypes type = TImage::kUnknown;
+    if(format == "png") type = TImage::kPng;
+    else if(format == "jpg" || format == "jpeg") type = TImage::kJpeg;
+    else if(format == "gif") type = TImage::kGif;
+
+    std::string &bytes = OutputBuffers[file];
+    if(type != TImage::kUnknown){
+      if(!image){
+        image = TImage::Create();
+        image->FromPad(Canvas); //  Painted once for all bitmap formats
+      }
+      char *buffer = nullptr;
+      Int_t size = 0;
+      image->GetImageBuffer(&buffer, &size, type);
+      if(buffer) bytes.assign(buffer, size);
+      free(buffer); //  Allocated by libAfterImage
+    }
+    else{
+      TString temp = TString::Format("%s/%s_%d.%s", gSystem->TempDirectory(), UniqueName("DrawnOutput").Data(), gSystem->GetPid(), format.Data());
+      Canvas->SaveAs(temp);
+      std::ifstream in(temp.Data(), std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+      in.close();
+      gSystem->Unlink(temp);
+    }
+    if(bytes.empty()){
+      delete image;
+      Abort(Form("Could not encode %s.", file.Data()));
+    }
+  }
+  delete image;
+}
+
+TString Plotting::ObjectName(TString name){
+  if(name.Last('/') >= 0) name.Remove(0, name.Last('/') + 1);
+  if(name.Last('.') > 0) name.Remove(name.Last('.'));
+  return name;
+}
+
+Plotting::ContourGuard::ContourGuard(const std::vector<ContourSetting> &contours){
+  for( Int_t i = 0; i < (Int_t)contours.size(); ++i){
+    TH1 *h = contours.at(i).hist;
+    Previous p = {h, h->TestBit(TH1::kUserContour), {}};
+    const Int_t levels = h->GetContour();
+    for( Int_t l = 0; l < levels; ++l) p.levels.push_back(h->GetContourLevel(l));
+    previous.push_back(p);
+    h->SetContour(contours.at(i).contours);
+  }
+}
+
+Plotting::ContourGuard::~ContourGuard(){
+  //  Reverse order, so a hist drawn twice gets its own contours back
+  for( Int_t i = (Int_t)previous.size() - 1; i >= 0; --i){
+    const Previous &p = previous.at(i);
+    if(p.user) p.hist->SetContour((Int_t)p.levels.size(), p.levels.data());
+    else p.hist->SetContour((Int_t)p.levels.size());
+  }
+}
+
+std::vector<TObject*> Plotting::DetachScene(){
+  std::vector<TObject*> objects;
+  objects.swap(PlotObjects);
+  std::set<TObject*> owned(objects.begin(), objects.end());
+  std::map<TObject*, TObject*> copies;
+  TDirectory::TContext NoDirectory(nullptr);  //  Copied hists are not added to gDirectory
+  auto copy = [&](TObject *obj){
+    if(owned.count(obj) || obj->TestBit(TObject::kCanDelete) || obj->InheritsFrom(TFrame::Class())) return obj;  //  Deleted with the plot or by the pad it was drawn on
+    if(!copies.count(obj)){
+      copies[obj] = obj->Clone();
+      objects.push_back(copies[obj]);
+    }
+    return copies[obj];
+  };
+
+  //  The legends are fixed after the pads, so their entries point to the copies that are drawn
+  std::vector<TLegend*> legends;
+  std::function<void(TPad*)> detach = [&](TPad *pad){
+    for( TObjLink *link = pad->GetListOfPrimitives()->FirstLink(); link; link = link->Next()){
+      TObject *obj = link->GetObject();
+      if(obj->InheritsFrom(TPad::Class())) detach((TPad*) obj);
+      else{
+        if(obj->InheritsFrom(TLegend::Class())) legends.push_back((TLegend*) obj);
+        link->SetObject(copy(obj));
+      }
+    }
+  };
+  detach(Canvas);
+  for( Int_t i = 0; i < (Int_t)legends.size(); ++i){
+    for( TObjLink *link = legends.at(i)->GetListOfPrimitives()->FirstLink(); link; link = link->Next()){
+      TLegendEntry *entry = (TLegendEntry*) link->GetObject();
+      if(entry->GetObject()) entry->SetObject(copy(entry->GetObject()));
+    }
+  }
+  return objects;
+}
+
+void Plotting::InitializeLegend(){
+  leg = Own(new TLegend(LegendBorders[0][0], LegendBorders[1][0], LegendBorders[0][1], LegendBorders[1][1]));
+  leg->SetHeader(""); //  Remove title of legend
+  leg->SetTextFont(42);
+  leg->SetTextSize(0.035);
+  leg->SetBorderSize(0);  //  Remove black rectangle around legend
+  leg->SetFillStyle(1001);  // Solid white background to make legend readable. Set to 0 to make it hollow
+}
+
+TH2D* Plotting::NewFrame(TString name, Double_t xlow, Double_t xup, Double_t ylow, Double_t yup){
+  //  The frame is only drawn to get the axes, so one bin per axis is enough. The axis ranges and labels are independent of the number of bins.
+  TDirectory::TContext NoDirectory(nullptr);  //  Only changes the (thread local) gDirectory until the frame is created
+  TH2D* frame = new TH2D(UniqueName(name), name, 1, xlow, xup, 1, ylow, yup);
+
+  frame->SetTitle("");
+  frame->SetStats(0);
+  return frame;
+}
+
+void Plotting::SetFuncSampling(Bool_t adaptive, Double_t tolerance, Int_t threads){
+  SceneChanged = true;
+  FuncSampling = adaptive;
+  SamplingTolerance = tolerance > 0 ? tolerance : 0.25;
+#ifdef R__USE_IMT
+  Int_t nthreads = threads > 0 ? threads : (Int_t)std::thread::hardware_concurrency();
+  SamplingPool.reset(adaptive && nthreads > 1 ? new ROOT::TThreadExecutor(nthreads) : nullptr);
+#else
+  (void)threads;  //  No thread pool without imt
+#endif
+}
+
+void Plotting::EvalFunc(TF1* f, const std::vector<Double_t> &x, std::vector<Double_t> &y){
+  const Int_t n = x.size();
+  y.resize(n);
+#ifdef R__USE_IMT
+  Int_t chunks = SamplingPool ? std::min((Int_t)SamplingPool->GetPoolSize(), n/16) : 1;  //  A thread is only worth it for a few points
+  if(chunks >= 2){
+    SamplingPool->Foreach([&](Int_t chunk){
+      const Int_t last = (Long64_t)n*(chunk + 1)/chunks;
+      for( Int_t i = (Long64_t)n*chunk/chunks; i < last; ++i) y[i] = f->Eval(x[i]);
+    }, ROOT::TSeqI(chunks));
+    return;
+  }
+#endif
+  for( Int_t i = 0; i < n; ++i) y[i] = f->Eval(x[i]);
+}
+
+Plotting::FuncSamples& Plotting::SampleFunc(TF1* f, Double_t xlow, Double_t xup, Double_t ylow, Double_t yup, Bool_t logx, Bool_t logy, Double_t w, Double_t h){
+
+  FuncSamples &s = SampleCache[f];
+  Double_t low = std::max(xlow, f->GetXmin());
+  Double_t up = std::min(xup, f->GetXmax());
+  if(logx && low <= 0) low = 1e-3*up; //  A log axis can't start at 0
+  if(logy && ylow <= 0) ylow = 1e-3*yup;
+  std::vector<Double_t> signature = {low, up, (Double_t)logx};
+  AppendSignature(signature, f);
+  if(!(up > low) || !(yup > ylow) || !(w > 0) || !(h > 0)){
+    s.x.clear();
+    s.y.clear();
+    s.signature.clear();
+    return s;
+  }
+
+  //  Pixels are linear in the (log) coordinates
+  auto X = [&](Double_t x){ return logx ? log10(x) : x; };
+  auto Y = [&](Double_t y){ return logy ? (y > 0 ? log10(y) : std::numeric_limits<Double_t>::quiet_NaN()) : y; };
+  Double_t scale[2] = {w/(X(up) - X(low)), h/(Y(yup) - Y(ylow))};
+  Bool_t same = s.signature == signature;
+  if(same && s.logy == logy && scale[0] <= s.scale[0]*(1 + 1e-9) && scale[1] <= s.scale[1]*(1 + 1e-9)) return s;  //  Fine enough already
+
+  if(!same){
+    Int_t n = std::max(16, (Int_t)(w/2));
+    s.x.resize(n + 1);
+    for( Int_t i = 0; i <= n; ++i) s.x[i] = logx ? pow(10, X(low) + (X(up) - X(low))*i/n) : low + (up - low)*i/n;
+    EvalFunc(f, s.x, s.y);
+  }
+  s.signature = signature;
+  s.logy = logy;
+  s.scale[0] = scale[0];
+  s.scale[1] = scale[1];
+
+  //  Every round evaluates the middles of all segments that are still checked. A segment stays checked while the function passes its middle
+  //  further than the tolerance from the straight line, or it crosses the border of where the function is defined, and it is wider than 1/16 pixel
+  std::vector<Char_t> check(s.x.size() - 1, 1);
+  std::vector<Double_t> mx, my, nx, ny;
+  std::vector<Char_t> ncheck;
+  for( Int_t round = 0; round < 16; ++round){
+    mx.clear();
+    for( Int_t i = 0; i + 1 < (Int_t)s.x.size(); ++i){
+      if(check[i] && (X(s.x[i+1]) - X(s.x[i]))*scale[0] > 1./16) mx.push_back(logx ? pow(10, 0.5*(X(s.x[i]) + X(s.x[i+1]))) : 0.5*(s.x[i] + s.x[i+1]));
+      else check[i] = 0;
+    }
+    if(mx.empty()) break;
+    EvalFunc(f, mx, my);
+
+    nx.clear();
+    ny.clear();
+    ncheck.clear();
+    Int_t m = 0;
+    for( Int_t i = 0; i + 1 < (Int_t)s.x.size(); ++i){
+      nx.push_back(s.x[i]);
+      ny.push_back(s.y[i]);
+      if(!check[i]){
+        ncheck.push_back(0);
+        continue;
+      }
+      Double_t a = Y(s.y[i]), b = Y(s.y[i+1]), c = Y(my[m]);
+      Int_t valid = std::isfinite(a) + std::isfinite(b) + std::isfinite(c);
+      Bool_t split = valid == 3 ? std::abs(c - 0.5*(a + b))*scale[1] > SamplingTolerance : valid > 0;
+      nx.push_back(mx[m]);
+      ny.push_back(my[m]);
+      ncheck.push_back(split);
+      ncheck.push_back(split);
+      m++;
+    }
+    nx.push_back(s.x.back());
+    ny.push_back(s.y.back());
+    s.x.swap(nx);
+    s.y.swap(ny);
+    check.swap(ncheck);
+  }
+  return s;
+}
+
+TGraph* Plotting::SampledFunc(TF1* f, TPad* pad, Double_t ylow, Double_t yup, Bool_t logx, Bool_t logy){
+  Double_t w = pad->GetWw()*pad->GetAbsWNDC()*(1 - pad->GetLeftMargin() - pad->GetRightMargin());
+  Double_t h = pad->GetWh()*pad->GetAbsHNDC()*(1 - pad->GetTopMargin() - pad->GetBottomMargin());
+  FuncSamples &s = SampleFunc(f, AxisRange[0][0], AxisRange[0][1], ylow, yup, logx, logy, w, h);
+  if(!s.graph) s.graph = new TGraph();
+  Int_t n = 0;
+  s.graph->Set(s.x.size());
+  for( Int_t i = 0; i < (Int_t)s.x.size(); ++i){
+    if(!std::isfinite(s.y[i]) || (logy && s.y[i] <= 0)) continue;  //  A TGraph can't interrupt its line, the valid points are joined
+    s.graph->SetPoint(n++, s.x[i], s.y[i]);
+  }
+  s.graph->Set(n);
+  s.graph->SetLineColor(f->GetLineColor());
+  s.graph->SetLineStyle(f->GetLineStyle());
+  s.graph->SetLineWidth(f->GetLineWidth());
+  return s.graph;
+}
+
+void Plotting::SetRaster(Bool_t raster, Int_t dpi){
+  SceneChanged = true;
+  Raster = raster;
+  RasterDPI = dpi > 0 ? dpi : 300;
+}
+
+void Plotting::RasterizeFrame(Double_t xlow, Double_t xup, Double_t ylow, Double_t yup, Bool_t logx, Bool_t logy, Bool_t logz, const std::function<void(Double_t)> &drawData){
+
+  //  The pdf page is as wide as the paper of gStyle (20 cm by default), the frame covers the part inside the margins
+  Double_t fx = 1 - Canvas->GetLeftMargin() - Canvas->GetRightMargin();
+  Double_t fy = 1 - Canvas->GetBottomMargin() - Canvas->GetTopMargin();
+  Float_t paperw, paperh;
+  gStyle->GetPaperSize(paperw, paperh);
+  Int_t width = std::max(1, (Int_t)(paperw/2.54*fx*RasterDPI));
+  Int_t height = std::max(1, (Int_t)(width*fy*CanvasDimensions[1]/(fx*CanvasDimensions[0])));
+
+  //  The pad is created before the image, so CleanUp deletes the image first
+  TPad *pad = Own(new TPad(UniqueName("RasterPad"), "", Canvas->GetLeftMargin(), Canvas->GetBottomMargin(), 1 - Canvas->GetRightMargin(), 1 - Canvas->GetTopMargin()));
+  pad->SetMargin(0, 0, 0, 0);
+  TImage *image = Own(TImage::Create());
+  {
+    std::lock_guard<std::recursive_mutex> lock(OutputMutex);  //  Painting into an image goes through the global gVirtualPS as well
+    TCanvas *raster = new TCanvas(UniqueName("RasterCanvas"), "", width, height);
+    raster->SetCanvasSize(width, height);
+    raster->SetMargin(0, 0, 0, 0);
+    raster->SetLogx(logx);
+    raster->SetLogy(logy);
+    raster->SetLogz(logz);
+    raster->cd();
+    TH2D *frame = NewFrame("RasterFrame", xlow, xup, ylow, yup);
+    frame->Draw("AH");  //  Only sets the coordinates of the pad, no axes
+    drawData(width/(fx*CanvasDimensions[0]));
+    raster->Modified();
+    raster->Update();
+    image->FromPad(raster);
+    delete frame;
+    delete raster;
+  }
+
+  Canvas->cd();
+  pad->Draw();
+  pad->cd();
+  image->Draw();
+  Canvas->cd();
+}
+
+Bool_t Plotting::IsAutoRange(Double_t border){
+  return border > 41.99 && border < 42.01;
+}
+
+void Plotting::Extrema::Merge(const Extrema &other){
+  min = other.min < min ? other.min : min;
+  max = other.max > max ? other.max : max;
+  minpos = other.minpos < minpos ? other.minpos : minpos;
+  xmin = other.xmin < xmin ? other.xmin : xmin;
+  xmax = other.xmax > xmax ? other.xmax : xmax;
+}
+
+template <class Kernel> Bool_t Plotting::VisitBinArray(TH1* h, Kernel&& kernel){
+  //  Profiles store the sums of their entries in the array, the bin content has to be calculated from them
+  if(h->InheritsFrom(TProfile::Class()) || h->InheritsFrom(TProfile2D::Class())) return false;
+  if(TArrayD* a = dynamic_cast<TArrayD*>(h)) { kernel(a->GetArray()); return true; }
+  if(TArrayF* a = dynamic_cast<TArrayF*>(h)) { kernel(a->GetArray()); return true; }
+  if(TArrayI* a = dynamic_cast<TArrayI*>(h)) { kernel(a->GetArray()); return true; }
+  if(TArrayS* a = dynamic_cast<TArrayS*>(h)) { kernel(a->GetArray()); return true; }
+  if(TArrayC* a = dynamic_cast<TArrayC*>(h)) { kernel(a->GetArray()); return true; }
+  return false;
+}
+
+template <typename T> void Plotting::HistExtremaKernel(const T* content, Int_t first, Int_t last, Extrema &e){
+  Double_t min = e.min, max = e.max, minpos = e.minpos;
+  for(Int_t i = first; i <= last; ++i){
+    const Double_t v = content[i];
+    min = v < min ? v : min;
+    max = v > max ? v : max;
+    minpos = (v > 0 && v < minpos) ? v : minpos;
+  }
+  e.min = min;
+  e.max = max;
+  e.minpos = minpos;
+}
+
+template <Bool_t HasEX, Bool_t HasEY> void Plotting::GraphExtremaKernel(const Double_t* x, const Double_t* y, const Double_t* exl, const Double_t* exh,
+                                                                        const Double_t* eyl, const Double_t* eyh, Int_t n, Double_t xlow, Double_t xup, Extrema &e){
+  const Double_t inf = std::numeric_limits<Double_t>::infinity();
+  Double_t min = e.min, max = e.max, minpos = e.minpos, xmin = e.xmin, xmax = e.xmax;
+  for(Int_t i = 0; i < n; ++i){
+    //  Points outside of the window are replaced by neutral values instead of skipped
+    const Bool_t visible = x[i] >= xlow && x[i] <= xup;
+    const Double_t low = y[i] - (HasEY ? eyl[i] : 0.);
+    const Double_t up = y[i] + (HasEY ? eyh[i] : 0.);
+    const Double_t left = x[i] - (HasEX ? exl[i] : 0.);
+    const Double_t right = x[i] + (HasEX ? exh[i] : 0.);
+    min = (visible && low < min) ? low : min;
+    max = (visible && up > max) ? up : max;
+    //  For log axes the lower error can reach below 0. Then the point itself is the lowest visible value
+    const Double_t pos = low > 0 ? low : (y[i] > 0 ? y[i] : inf);
+    minpos = (visible && pos < minpos) ? pos : minpos;
+    xmin = (visible && left < xmin) ? left : xmin;
+    xmax = (visible && right > xmax) ? right : xmax;
+  }
+  e.min = min;
+  e.max = max;
+  e.minpos = minpos;
+  e.xmin = xmin;
+  e.xmax = xmax;
+}
+
+Plotting::Extrema Plotting::ScanHist(TH1* h, Double_t xlow, Double_t xup){
+
+  //  Only bins that are at least partially inside the window are used
+  Int_t nbins = h->GetNbinsX();
+  Int_t first = std::isinf(xlow) ? 1 : TMath::Max(1, h->GetXaxis()->FindFixBin(xlow));
+  Int_t last = std::isinf(xup) ? nbins : TMath::Min(nbins, h->GetXaxis()->FindFixBin(xup));
+  if(last > first && h->GetBinLowEdge(last) >= xup) last--;  //  The window ends exactly at the lower edge of that bin
+
+  Extrema e;
+  if(first <= last){
+    //  For 1D histograms the array index is the bin number
+    if(!VisitBinArray(h, [&](const auto* content){ HistExtremaKernel(content, first, last, e); })){
+      for(Int_t i = first; i <= last; ++i){
+        const Double_t v = h->GetBinContent(i);
+        e.min = v < e.min ? v : e.min;
+        e.max = v > e.max ? v : e.max;
+        if(v > 0 && v < e.minpos) e.minpos = v;
+      }
+    }
+    e.xmin = h->GetBinLowEdge(first);
+    e.xmax = h->GetBinLowEdge(last) + h->GetBinWidth(last);
+  }
+
+  //  Like GetMaximum/GetMinimum respect a maximum/minimum the user set for this histogram
+  if(h->GetMaximumStored() != -1111) e.max = h->GetMaximumStored();
+  if(h->GetMinimumStored() != -1111){
+    e.min = h->GetMinimumStored();
+    if(e.min > 0) e.minpos = e.min;
+  }
+
+  return e;
+}
+
+Plotting::Extrema Plotting::ScanGraph(TGraph* g, Double_t xlow, Double_t xup){
+  Extrema e;
+  const Double_t *exl = g->GetEXlow() ? g->GetEXlow() : g->GetEX(); //  TGraphAsymmErrors has low and high errors, TGraphErrors only one
+  const Double_t *exh = g->GetEXhigh() ? g->GetEXhigh() : g->GetEX();
+  const Double_t *eyl = g->GetEYlow() ? g->GetEYlow() : g->GetEY();
+  const Double_t *eyh = g->GetEYhigh() ? g->GetEYhigh() : g->GetEY();
+  Bool_t hasex = exl && exh;
+  Bool_t hasey = eyl && eyh;
+
+  if(hasex && hasey) GraphExtremaKernel<true, true>(g->GetX(), g->GetY(), exl, exh, eyl, eyh, g->GetN(), xlow, xup, e);
+  else if(hasey) GraphExtremaKernel<false, true>(g->GetX(), g->GetY(), exl, exh, eyl, eyh, g->GetN(), xlow, xup, e);
+  else if(hasex) GraphExtremaKernel<true, false>(g->GetX(), g->GetY(), exl, exh, eyl, eyh, g->GetN(), xlow, xup, e);
+  else GraphExtremaKernel<false, false>(g->GetX(), g->GetY(), exl, exh, eyl, eyh, g->GetN(), xlow, xup, e);
+  return e;
+}
+
+Plotting::Extrema Plotting::ScanFunc(TF1* f, Double_t xlow, Double_t xup){
+
+  //  Only the part of the function inside the window is drawn
+  Double_t fxlow = TMath::Max(xlow, f->GetXmin());
+  Double_t fxup = TMath::Min(xup, f->GetXmax());
+  Int_t npx = f->GetNpx();
+
+  std::vector<Double_t> signature = {fxlow, fxup};
+  AppendSignature(signature, f);
+  auto cached = ExtremaCache.find(f);
+  if(cached != ExtremaCache.end() && cached->second.signature == signature) return cached->second.extrema;
+
+  Extrema e;
+  if(fxup > fxlow && npx > 0){
+    e.xmin = fxlow;
+    e.xmax = fxup;
+    for(Int_t i = 0; i <= npx; ++i){
+      const Double_t v = f->Eval(fxlow + i*(fxup - fxlow)/npx);
+      if(!std::isfinite(v)) continue;  //  e.g. poles
+      e.min = v < e.min ? v : e.min;
+      e.max = v > e.max ? v : e.max;
+      if(v > 0 && v < e.minpos) e.minpos = v;
+    }
+  }
+
+  ExtremaCache[f] = {signature, e};
+  return e;
+}
+
+void Plotting::AutoSetAxisRanges(Bool_t logy){
+
+  if(hists.size() < 1 && graphs.size() < 1 && funcs.size() < 1) Abort("No histogram or graph given.");
+
+  //  Only the visible x window is scanned. If the x range is autoset, everything is visible
+  const Double_t inf = std::numeric_limits<Double_t>::infinity();
+  Double_t xlow = IsAutoRange(AxisRange[0][0]) ? -inf : AxisRange[0][0];
+  Double_t xup = IsAutoRange(AxisRange[0][1]) ? inf : AxisRange[0][1];
+
+  //  One pass over every hist and graph gives their y extrema and x extent
+  Extrema histExtrema, graphExtrema;
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i) histExtrema.Merge(ScanHist(hists.at(i), xlow, xup));
+  for( Int_t i = 0; i < (Int_t)graphs.size(); ++i) graphExtrema.Merge(ScanGraph(graphs.at(i), xlow, xup));
+
+  //  The hists are shown bin by bin from edge to edge. Graphs only would have their outermost points on the frame, so leave 10% space like ROOT does
+  Double_t xmin = histExtrema.xmin < graphExtrema.xmin ? histExtrema.xmin : graphExtrema.xmin;
+  Double_t xmax = histExtrema.xmax > graphExtrema.xmax ? histExtrema.xmax : graphExtrema.xmax;
+  if(hists.size() < 1 && graphs.size() > 0 && xmax > xmin){
+    Double_t dx = 0.1*(xmax - xmin);
+    xmin = (xmin > 0 && xmin - dx <= 0) ? 0.5*xmin : xmin - dx; //  Don't cross 0 for log x axes
+    xmax = xmax + dx;
+  }
+  else if(hists.size() < 1 && graphs.size() < 1){
+    for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){ //  Only functions -> use their ranges
+      xmin = funcs.at(i)->GetXmin() < xmin ? funcs.at(i)->GetXmin() : xmin;
+      xmax = funcs.at(i)->GetXmax() > xmax ? funcs.at(i)->GetXmax() : xmax;
+    }
+  }
+  if (IsAutoRange(AxisRange[0][0]) && !std::isinf(xmin)) AxisRange[0][0] = xmin;
+  if (IsAutoRange(AxisRange[0][1]) && !std::isinf(xmax)) AxisRange[0][1] = xmax;
+
+  //  Functions are sampled in the now known window
+  Extrema all = histExtrema;
+  all.Merge(graphExtrema);
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i) all.Merge(ScanFunc(funcs.at(i), AxisRange[0][0], AxisRange[0][1]));
+
+  //  For logarithmic y axis the minimum has be be larger than 0
+  Double_t max = all.max; //  Estimated upper y border
+  Double_t min = logy ? all.minpos : all.min;
+  if(std::isinf(max) || std::isinf(min) || max < min){  //  Nothing (positive) to show in the window
+    max = logy ? 1 : (std::isinf(max) ? 1 : max);
+    min = logy ? 0.1*max : (max > 0 ? 0 : max - 1);
+  }
+
+  //  Leave space between highest/lowest bin and the axis borders so you can see every bin
+  max = logy ? 2*max : max+(max-min)/10;  //  With log scales a factor 2 isn't too much
+  min = logy ? 0.5*min : (max - 2*min > 0 ? (min > 0 ? 0 : 1.1*min) : min-(max-min)/8); //  max-2*min>0 ? min is small->go down to 0 : all bins rather full
+
+  //  If the respective range was set to 42 use the just calculated estimates
+  if (IsAutoRange(AxisRange[1][0])) AxisRange[1][0] = min;
+  if (IsAutoRange(AxisRange[1][1])) AxisRange[1][1] = max;
+}
+
+void Plotting::DrawLatex(const Double_t  PositX, const Double_t  PositY, TString text, const Double_t TextSize, const Double_t dDist, const Int_t font, const Int_t color){
+  SceneChanged = true;
+  std::vector<TString> LatStr;  //  Each element corresponds to a line of the printed latex string
+  TObjArray *textStr = text.Tokenize(";");  //  The semicolon seperates the string into different lines
+  for(Int_t i = 0; i<textStr->GetEntries() ; i++){
+     TObjString* tempObj     = (TObjString*) textStr->At(i);
+     LatStr.push_back( tempObj->GetString());
+   }
+  delete textStr;
+
+  //  Loop thru the latex lines and set the formatting
+  for( Int_t i = 0; i < (Int_t)LatStr.size(); ++i){
+      Latex.push_back( new TLatex(PositX, PositY - i*dDist, LatStr[i]));
+      Latex.at(Latex.size() - 1)->SetNDC();
+      Latex.at(Latex.size() - 1)->SetTextFont(font);
+      Latex.at(Latex.size() - 1)->SetTextColor(color);
+      Latex.at(Latex.size() - 1)->SetTextSize(TextSize);
+  }
+}
+
+void Plotting::NewLine(Double_t x1, Double_t y1, Double_t x2, Double_t y2, Int_t style, Int_t color , Int_t width, TString label){
+  SceneChanged = true;
+
+  //  Curly lines can be used to draw photons or similar
+  if (style < 0) {
+    TCurlyLine* line = new TCurlyLine(x1,y1,x2,y2);
+    line->SetLineColor(color);
+    line->SetLineWidth(width);
+    line->SetWaveLength(-0.02*style); //  Standard wavelength is 0.02 -> Style -1
+    clines.push_back(line);
+  }
+  else{
+    TLine* line = new TLine(x1,y1,x2,y2);
+    LegendLabelL.push_back(label);
+    line->SetLineColor(color);
+    line->SetLineStyle(style);
+    line->SetLineWidth(width);
+    lines.push_back(line);
+  }
+
+}
+
+void Plotting::SetCache(TString indexfile){
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+  CacheIndex = indexfile;
+  CacheEntries.clear();
+  if(!indexfile.Length()) return;
+
+  //  One line per written file: path, fingerprint, size, modification time. Later lines replace earlier ones
+  std::ifstream in(indexfile.Data());
+  std::string path;
+  CacheEntry entry;
+  while(in >> path >> std::hex >> entry.fingerprint >> std::dec >> entry.size >> entry.modtime) CacheEntries[path] = entry;
+}
+
+Int_t Plotting::GetCacheHits(){
+  return CacheHits;
+}
+
+Int_t Plotting::GetCacheMisses(){
+  return CacheMisses;
+}
+
+void Plotting::PrintCacheStatistics(){
+  Int_t total = CacheHits + CacheMisses;
+  cout << "Plot cache " << CacheIndex << ": " << CacheHits << " of " << total << " plots were up to date and skipped, " << CacheMisses << " were drawn" << endl;
+}
+
+Double_t Plotting::PlotProfile::Total() const {
+  Double_t total = 0;
+  for( Int_t i = 0; i < kNPhases; ++i) total += seconds[i];
+  return total;
+}
+
+const char* Plotting::PlotProfile::PhaseName(Int_t phase){
+  static const char* names[kNPhases] = {"input", "canvas", "axis", "draw", "legend", "export"};
+  return names[phase];
+}
+
+void Plotting::EnableProfiling(Bool_t profiling){
+  Profiling = profiling;
+}
+
+std::vector<Plotting::PlotProfile> Plotting::GetProfiles(){
+  std::lock_guard<std::mutex> lock(ProfileMutex);
+  return Profiles;
+}
+
+const Plotting::PlotProfile& Plotting::GetLastProfile() const {
+  return LastProfile;
+}
+
+void Plotting::ResetProfiles(){
+  std::lock_guard<std::mutex> lock(ProfileMutex);
+  Profiles.clear();
+  for(auto &queued : QueuedProfiles) queued.second = std::numeric_limits<size_t>::max(); //  Dropped, the writer only takes them off the list
+}
+
+void Plotting::WriteProfileReport(TString file){
+  //  Sum the profiles per class. The last entry sums all classes
+  std::vector<TString> classes;
+  std::map<TString, PlotProfile> sums;
+  std::map<TString, std::map<TString, Int_t>> counts; //  Plots per class and result
+  WaitForWriter();  //  Until then the asynchronous plots have no bytes
+  {
+    std::lock_guard<std::mutex> lock(ProfileMutex);
+    for( Int_t i = 0; i < (Int_t)Profiles.size(); ++i){
+      const PlotProfile &p = Profiles.at(i);
+      for( TString c : {p.plotclass, TString("all")}){
+        if(!sums.count(c) && c != "all") classes.push_back(c);
+        PlotProfile &sum = sums[c];
+        sum.plotclass = c;
+        for( Int_t j = 0; j < kNPhases; ++j) sum.seconds[j] += p.seconds[j];
+        sum.objects += p.objects;
+        sum.bins += p.bins;
+        sum.points += p.points;
+        sum.bytes += p.bytes;
+        counts[c][p.result]++;
+        if(p.async) counts[c]["async"]++;
+      }
+    }
+  }
+  classes.push_back("all");
+
+  const char* results[] = {"drawn", "updated", "unchanged", "cached", "aborted"};
+  Int_t pid = gSystem->GetPid();
+  std::ofstream out(file.Data());
+  if(!out) { cerr << "Could not write the profile report " << file << endl; return; }
+  Bool_t json = file.EndsWith(".json");
+
+  if(json) out << "{\n  \"pid\": " << pid << ",\n  \"classes\": [\n";
+  else{
+    out << "pid,class,plots";
+    for( const char* r : results) out << "," << r;
+    for( Int_t j = 0; j < kNPhases; ++j) out << "," << PlotProfile::PhaseName(j) << "_seconds";
+    out << ",total_seconds,objects,bins,points,bytes,async\n";
+  }
+
+  for( Int_t i = 0; i < (Int_t)classes.size(); ++i){
+    PlotProfile &sum = sums[classes.at(i)];
+    std::map<TString, Int_t> &count = counts[classes.at(i)];
+    Int_t plots = 0;
+    for( const char* r : results) plots += count[r];
+    if(json){
+      out << "    {\"class\": \"" << classes.at(i) << "\", \"plots\": " << plots;
+      for( const char* r : results) out << ", \"" << r << "\": " << count[r];
+      for( Int_t j = 0; j < kNPhases; ++j) out << Form(", \"%s_seconds\": %.6f", PlotProfile::PhaseName(j), sum.seconds[j]);
+      out << Form(", \"total_seconds\": %.6f, \"objects\": %lld, \"bins\": %lld, \"points\": %lld, \"bytes\": %lld, \"async\": %d}", sum.Total(), sum.objects, sum.bins, sum.points, sum.bytes, count["async"]);
+      out << (i + 1 < (Int_t)classes.size() ? ",\n" : "\n");
+    }
+    else{
+      out << pid << "," << classes.at(i) << "," << plots;
+      for( const char* r : results) out << "," << count[r];
+      for( Int_t j = 0; j < kNPhases; ++j) out << Form(",%.6f", sum.seconds[j]);
+      out << Form(",%.6f,%lld,%lld,%lld,%lld,%d\n", sum.Total(), sum.objects, sum.bins, sum.points, sum.bytes, count["async"]);
+    }
+  }
+  if(json) out << "  ]\n}\n";
+}
+
+Plotting::Profiler::Profiler(Plotting *plotting, TString plotclass, TString name) : P(plotting), Active(Profiling && !plotting->HostPad) {
+  if(!Active) return;
+  Id = ++ProfileCounter;
+  P->ProfileId = Id;
+  P->ProfileQueued = false;
+  Profile.plotclass = plotclass;
+  Profile.name = name;
+  Start = std::chrono::steady_clock::now();
+}
+
+void Plotting::Profiler::Phase(ProfilePhase phase){
+  if(!Active) return;
+  auto now = std::chrono::steady_clock::now();
+  Profile.seconds[Running] += std::chrono::duration<Double_t>(now - Start).count();
+  Running = phase;
+  Start = now;
+  if(phase == kExportPhase) Exported = true;
+}
+
+void Plotting::Profiler::Result(TString result){
+  Profile.result = result;
+}
+
+void Plotting::Profiler::Count(TH1* h){
+  if(!Active) return;
+  Profile.objects++;
+  Profile.bins += (Long64_t)h->GetNbinsX() * h->GetNbinsY() * h->GetNbinsZ();
+}
+
+void Plotting::Profiler::Count(TGraph* g){
+  if(!Active) return;
+  Profile.objects++;
+  Profile.points += g->GetN();
+}
+
+void Plotting::Profiler::Count(TF1* f){
+  if(!Active) return;
+  Profile.objects++;
+  Profile.points += f->GetNpx();
+}
 
-void Plotting::SetLegend(Double_t x1, Double_t x2, Double_t y1, Double_t y2){
-  LegendBorders[0][0] = x1;
-  LegendBorders[0][1] = x2;
-  LegendBorders[1][0] = y1;
-  LegendBorders[1][1] = y2;
-} //  These parameters will be used when Plot() calls InitializeLegend
+void Plotting::Profiler::Count(Int_t objects){
+  if(Active) Profile.objects += objects;
+}
 
-void Plotting::InitializeLegend(){
-  leg = new TLegend(LegendBorders[0][0], LegendBorders[1][0], LegendBorders[0][1], LegendBorders[1][1]);
-  leg->SetHeader(""); //  Remove title of legend
-  leg->SetTextFont(42);
-  leg->SetTextSize(0.035);
-  leg->SetBorderSize(0);  //  Remove black rectangle around legend
-  leg->SetFillStyle(1001);  // Solid white background to make legend readable. Set to 0 to make it hollow
+Plotting::Profiler::~Profiler(){
+  if(!Active) return;
+  Profile.seconds[Running] += std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - Start).count();
+  if(std::uncaught_exceptions()) Profile.result = "aborted";
+  Bool_t written = Exported && Profile.result != "aborted";
+  if(written && P->MemoryOutput){
+    for(const auto &output : P->OutputBuffers) Profile.bytes += output.second.size();
+  }
+  else if(written && P->ProfileQueued) Profile.async = true;  //  The writer stores the bytes once the files are written
+  else if(written){
+    std::vector<TString> files = P->OutputFiles(Profile.name);
+    for( Int_t i = 0; i < (Int_t)files.size(); ++i) Profile.bytes += FileSize(files.at(i));
+  }
+  P->LastProfile = Profile;
+  P->ProfileId = 0;
+
+  std::lock_guard<std::mutex> lock(ProfileMutex);
+  auto queued = QueuedBytes.find(Id);
+  if(queued != QueuedBytes.end()){ //  The writer was faster
+    if(Profile.async) Profile.bytes = queued->second;
+    QueuedBytes.erase(queued);
+  }
+  else if(P->ProfileQueued) QueuedProfiles[Id] = Profile.async ? Profiles.size() : std::numeric_limits<size_t>::max();  //  An aborted plot has no bytes
+  Profiles.push_back(Profile);
 }
 
-void Plotting::AutoSetAxisRanges(Bool_t logy){
+void Plotting::StoreQueuedBytes(Long64_t id, const std::vector<TString> &files){
+  Long64_t bytes = 0;
+  for( Int_t i = 0; i < (Int_t)files.size(); ++i) bytes += FileSize(files.at(i));
+  std::lock_guard<std::mutex> lock(ProfileMutex);
+  auto stored = QueuedProfiles.find(id);
+  if(stored == QueuedProfiles.end()) QueuedBytes[id] = bytes;  //  Taken by the Profiler when Plot() returns
+  else{
+    if(stored->second < Profiles.size()) Profiles.at(stored->second).bytes = bytes;
+    QueuedProfiles.erase(stored);
+  }
+}
 
-  if(hists.size() > 0){
-    Double_t max = hists.at(0)->GetMaximum(); //  Estimated upper y border
+Long64_t Plotting::FileSize(TString file){
+  Long_t id, flags, modtime;
+  Long64_t size;
+  return gSystem->GetPathInfo(file, &id, &size, &flags, &modtime) == 0 ? size : 0;
+}
 
-    //  For logarithmic y axis the minimum has be be larger than 0
-    Double_t min = logy ? hists.at(0)->GetMinimum(0.) : hists.at(0)->GetMinimum();
+Bool_t Plotting::CacheActive(){
+  return CacheIndex.Length() && !BookName.Length() && !HostPad && !MemoryOutput && !OutputDirectory;
+}
 
-    //  Find the smalles and largest bin in all loaded histograms (larger than 0 for logy)
-    for ( Int_t i = 0; i < (Int_t)hists.size(); i++) {
-      max = hists.at(i)->GetMaximum() > max ? hists.at(i)->GetMaximum() : max;
-      min = (hists.at(i)->GetMinimum() < min  && (!logy || hists.at(i)->GetMinimum() > 0)) ? hists.at(i)->GetMinimum() : min;
-    }
+Bool_t Plotting::CacheHit(TString name, const Fingerprint &fp){
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+  std::vector<TString> files = OutputFiles(name);
+  Bool_t hit = files.size() > 0;
+  for(Int_t i = 0; i < (Int_t)files.size() && hit; ++i){
+    auto entry = CacheEntries.find(files.at(i));
+    Long_t id, flags, modtime;
+    Long64_t size;
+    hit = entry != CacheEntries.end() && entry->second.fingerprint == fp.hash && gSystem->GetPathInfo(files.at(i), &id, &size, &flags, &modtime) == 0
+          && size == entry->second.size && modtime == entry->second.modtime;
+  }
+  if(hit) CacheHits++;
+  else CacheMisses++;
+  return hit;
+}
 
-    //  Leave space between highest/lowest bin and the axis borders so you can see every bin
-    max = logy ? 2*max : max+(max-min)/10;  //  With log scales a factor 2 isn't too much
-    min = logy ? 0.5*min : (max - 2*min > 0 ? (min > 0 ? 0 : 1.1*min) : min-(max-min)/8); //  max-2*min>0 ? min is small->go down to 0 : all bins rather full
+void Plotting::CacheStore(TString name, const Fingerprint &fp){
+  std::vector<TString> files = OutputFiles(name);
+  ULong64_t fingerprint = fp.hash;
+  if(AsyncQueueSize > 0) Enqueue([files, fingerprint](){ CacheStoreFiles(files, fingerprint); }); //  The files are not written yet
+  else CacheStoreFiles(files, fingerprint);
+}
 
-    //  If the respective range was set to 42 use the just calculated estimates
-    if (AxisRange[1][0] > 41.99 && AxisRange[1][0] < 42.01) AxisRange[1][0] = min;
-    if (AxisRange[1][1] > 41.99 && AxisRange[1][1] < 42.01) AxisRange[1][1] = max;
-    if (AxisRange[0][0] > 41.99 && AxisRange[0][0] < 42.01) AxisRange[0][0] = hists.at(0)->GetBinLowEdge(1);
-    if (AxisRange[0][1] > 41.99 && AxisRange[0][1] < 42.01) {//  Get the x axis range assuming the hists have the same bins
-      AxisRange[0][1] = hists.at(0)->GetBinLowEdge(hists.at(0)->GetNbinsX())+hists.at(0)->GetBinWidth(hists.at(0)->GetNbinsX());
-    }
+void Plotting::CacheStoreFiles(const std::vector<TString> &files, ULong64_t fingerprint){
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+  std::ofstream out(CacheIndex.Data(), std::ios::app);
+  for(Int_t i = 0; i < (Int_t)files.size(); ++i){
+    CacheEntry entry;
+    Long_t id, flags;
+    entry.fingerprint = fingerprint;
+    if(gSystem->GetPathInfo(files.at(i), &id, &entry.size, &flags, &entry.modtime) != 0) continue;  //  Not written
+    CacheEntries[files.at(i)] = entry;
+    out << files.at(i) << "\t" << std::hex << entry.fingerprint << std::dec << "\t" << entry.size << "\t" << entry.modtime << "\n";
+  }
+}
+
+void Plotting::Fingerprint::Add(const void* data, size_t size){
+  const UChar_t *bytes = (const UChar_t*) data;
+  for(size_t i = 0; i < size; ++i){
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
   }
-  else if(graphs.size() > 0){
-    //  When you only have graphs convert the first one into a hist and use its axis range. If you have multiple graphs the range has to be chosen manually
-    TH1F* hAxisFromGraph = graphs.at(0)->GetHistogram();
+}
 
-    Double_t max = hAxisFromGraph->GetMaximum(); //  Estimated upper y border
+void Plotting::Fingerprint::Add(Double_t x){
+  Add(&x, sizeof(x));
+}
 
-    //  For logarithmic y axis the minimum has be be larger than 0
-    Double_t min = logy ? hAxisFromGraph->GetMinimum(0.) : hAxisFromGraph->GetMinimum();
+void Plotting::Fingerprint::Add(TString s){
+  Add(s.Data(), s.Length() + 1); //  With the terminating 0, so "ab","c" differs from "a","bc"
+}
 
-    //  Leave space between highest/lowest bin and the axis borders so you can see every bin
-    max = logy ? 2*max : max+(max-min)/10;  //  With log scales a factor 2 isn't too much
-    min = logy ? 0.5*min : (max - 2*min > 0 ? 0 : min-(max-min)/8); //  max-2*min>0 ? min is small->go down to 0 : all bins rather full
+template <class T> void Plotting::Fingerprint::AddStyle(const T* o){
+  Add(o->GetMarkerStyle());
+  Add(o->GetMarkerColor());
+  Add(o->GetMarkerSize());
+  Add(o->GetLineStyle());
+  Add(o->GetLineColor());
+  Add(o->GetLineWidth());
+  Add(o->GetFillStyle());
+  Add(o->GetFillColor());
+}
 
-    //  If the respective range was set to 42 use the just calculated estimates
-    if (AxisRange[1][0] > 41.99 && AxisRange[1][0] < 42.01) AxisRange[1][0] = min;
-    if (AxisRange[1][1] > 41.99 && AxisRange[1][1] < 42.01) AxisRange[1][1] = max;
-    if (AxisRange[0][0] > 41.99 && AxisRange[0][0] < 42.01) AxisRange[0][0] = hAxisFromGraph->GetBinLowEdge(1);
-    if (AxisRange[0][1] > 41.99 && AxisRange[0][1] < 42.01) {//  Get the x axis range assuming the hists have the same bins
-      AxisRange[0][1] = hAxisFromGraph->GetBinLowEdge(hAxisFromGraph->GetNbinsX())+hAxisFromGraph->GetBinWidth(hAxisFromGraph->GetNbinsX());
-    }
+void Plotting::Fingerprint::Add(TH1* h){
+  Add(h->ClassName());
+  TAxis *axes[3] = {h->GetXaxis(), h->GetYaxis(), h->GetZaxis()};
+  for( Int_t k = 0; k < 3; ++k){
+    Add(axes[k]->GetNbins());
+    Add(axes[k]->GetXmin());
+    Add(axes[k]->GetXmax());  //  Not the range, which InitializeAxis sets on the hist itself (the user range is in the fingerprint of the plot)
+    const TArrayD *edges = axes[k]->GetXbins();
+    if(edges->fN) Add(edges->GetArray(), edges->fN*sizeof(Double_t));
   }
-  else if(funcs.size() > 0){ cout << "Warning: Only functions have been inserted..." << endl; }
-  else Abort("No histogram or graph given.");
+  Add(h->GetMaximumStored());
+  Add(h->GetMinimumStored());
+  AddStyle(h);
+  AddBins(h);
 }
 
-void Plotting::DrawLatex(const Double_t  PositX, const Double_t  PositY, TString text, const Double_t TextSize, const Double_t dDist, const Int_t font, const Int_t color){
-  std::vector<TString> LatStr;  //  Each element corresponds to a line of the printed latex string
-  TObjArray *textStr = text.Tokenize(";");  //  The semicolon seperates the string into different lines
-  for(Int_t i = 0; i<textStr->GetEntries() ; i++){
-     TObjString* tempObj     = (TObjString*) textStr->At(i);
-     LatStr.push_back( tempObj->GetString());
-   }
-
-  //  Loop thru the latex lines and set the formatting
-  for( Int_t i = 0; i < (Int_t)LatStr.size(); ++i){
-      Latex.push_back( new TLatex(PositX, PositY - i*dDist, LatStr[i]));
-      Latex.at(Latex.size() - 1)->SetNDC();
-      Latex.at(Latex.size() - 1)->SetTextFont(font);
-      Latex.at(Latex.size() - 1)->SetTextColor(color);
-      Latex.at(Latex.size() - 1)->SetTextSize(TextSize);
+void Plotting::Fingerprint::AddBins(TH1* h){
+  //  The stored arrays are hashed directly, profiles bin by bin
+  Int_t ncells = h->GetNcells();
+  if(!VisitBinArray(h, [&](const auto* content){ Add(content, ncells*sizeof(*content)); })){
+    for( Int_t bin = 0; bin < ncells; ++bin){
+      Add(h->GetBinContent(bin));
+      Add(h->GetBinError(bin));
+    }
+    return;
   }
+  if(h->GetSumw2N()) Add(h->GetSumw2()->GetArray(), h->GetSumw2N()*sizeof(Double_t));
 }
 
-void Plotting::NewLine(Double_t x1, Double_t y1, Double_t x2, Double_t y2, Int_t style, Int_t color , Int_t width, TString label){
+void Plotting::Fingerprint::Add(TGraph* g){
+  Add(g->ClassName());
+  Int_t n = g->GetN();
+  Add(n);
+  Add(g->GetX(), n*sizeof(Double_t));
+  Add(g->GetY(), n*sizeof(Double_t));
+  Double_t *errors[4] = {g->GetEXlow(), g->GetEXhigh(), g->GetEYlow(), g->GetEYhigh()};
+  for( Int_t k = 0; k < 4; ++k) if(errors[k]) Add(errors[k], n*sizeof(Double_t));
+  AddStyle(g);
+}
 
-  //  Curly lines can be used to draw photons or similar
-  if (style < 0) {
-    TCurlyLine* line = new TCurlyLine(x1,y1,x2,y2);
-    line->SetLineColor(color);
-    line->SetLineWidth(width);
-    line->SetWaveLength(-0.02*style); //  Standard wavelength is 0.02 -> Style -1
-    clines.push_back(line);
+void Plotting::Fingerprint::Add(TF1* f){
+  Add(f->GetName());
+  Add(f->GetTitle()); //  The formula for functions defined by a string
+  Add(f->GetXmin());
+  Add(f->GetXmax());
+  Add(f->GetNpx());
+  if(f->GetNpar()) Add(f->GetParameters(), f->GetNpar()*sizeof(Double_t));
+  AddStyle(f);
+}
+
+Plotting::Fingerprint Plotting::BaseFingerprint(TString name, Int_t logs){
+  Fingerprint fp;
+  fp.Add(name);
+  fp.Add(logs);
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i) { fp.Add(hists.at(i)); fp.Add(DrawOption.at(i).draw); fp.Add(LegendLabel.at(i)); }
+  for( Int_t i = 0; i < (Int_t)graphs.size(); ++i) { fp.Add(graphs.at(i)); fp.Add(DrawOptionG.at(i).draw); fp.Add(LegendLabelG.at(i)); }
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i) { fp.Add(funcs.at(i)); fp.Add(DrawOptionF.at(i).draw); fp.Add(LegendLabelF.at(i)); }
+  fp.Add(FuncSampling);
+  fp.Add(SamplingTolerance);
+  for( Int_t i = 0; i < (Int_t)lines.size(); ++i){
+    fp.Add(lines.at(i)->GetX1());
+    fp.Add(lines.at(i)->GetY1());
+    fp.Add(lines.at(i)->GetX2());
+    fp.Add(lines.at(i)->GetY2());
+    fp.Add(lines.at(i)->GetLineStyle());
+    fp.Add(lines.at(i)->GetLineColor());
+    fp.Add(lines.at(i)->GetLineWidth());
+    fp.Add(LegendLabelL.at(i));
   }
-  else{
-    TLine* line = new TLine(x1,y1,x2,y2);
-    LegendLabelL.push_back(label);
-    line->SetLineColor(color);
-    line->SetLineStyle(style);
-    line->SetLineWidth(width);
-    lines.push_back(line);
+  for( Int_t i = 0; i < (Int_t)clines.size(); ++i){
+    fp.Add(clines.at(i)->GetStartX());
+    fp.Add(clines.at(i)->GetStartY());
+    fp.Add(clines.at(i)->GetEndX());
+    fp.Add(clines.at(i)->GetEndY());
+    fp.Add(clines.at(i)->GetLineColor());
+    fp.Add(clines.at(i)->GetLineWidth());
   }
+  for( Int_t i = 0; i < (Int_t)Latex.size(); ++i){
+    fp.Add(Latex.at(i)->GetTitle());
+    fp.Add(Latex.at(i)->GetX());
+    fp.Add(Latex.at(i)->GetY());
+    fp.Add(Latex.at(i)->GetTextSize());
+    fp.Add(Latex.at(i)->GetTextFont());
+    fp.Add(Latex.at(i)->GetTextColor());
+  }
+  fp.Add(AxisRange, sizeof(AxisRange));
+  for( Int_t k = 0; k < 3; ++k) fp.Add(AxisLabel[k]);
+  fp.Add(AxisLabelOffset, sizeof(AxisLabelOffset));
+  fp.Add(LegendBorders, sizeof(LegendBorders));
+  fp.Add(CanvasMargins, sizeof(CanvasMargins));
+  fp.Add(CanvasDimensions, sizeof(CanvasDimensions));
+  for( Int_t i = 0; i < (Int_t)Formats.size(); ++i) fp.Add(Formats.at(i));
+  fp.Add(Raster);
+  fp.Add(RasterDPI);
+  return fp;
+}
 
+void Plotting::SetThrowOnAbort(Bool_t doThrow){
+  ThrowOnAbort = doThrow;
 }
 
 //  This function is called when a fatal error occured (e.g. draw a NULLptr)
 void Plotting::Abort(TString Message){
+  if(ThrowOnAbort) throw std::runtime_error(Message.Data());
   cerr << Message << " Aborting..." << endl;
-  exit(0);
+  exit(1);
+}
+
+void Plotting::SetTheme(const Theme &theme, Bool_t hashLabels){
+  CurrentTheme = theme;
+  HashLabels = hashLabels;
+}
+
+Int_t Plotting::ThemeColor(Int_t color){
+  if(!(color & Themes::RGB)) return color;
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex); //  New colors are added to the global list of colors
+  return TColor::GetColor((color >> 16) & 0xff, (color >> 8) & 0xff, color & 0xff);
+}
+
+template <class T> void Plotting::ApplyStyle(T* obj, Int_t count, TString label, Int_t style, Int_t size, Int_t color, Int_t linestyle){
+  Int_t i = (HashLabels && label.Length()) ? (Int_t)(label.Hash() & 0x7fffffff) : count;
+  Int_t c = (color == -1) ? ThemeColor(CurrentTheme.Color(i)) : color;
+  obj->SetMarkerStyle(( style == -1) ? CurrentTheme.Marker(i) : style);
+  obj->SetLineStyle(( linestyle == -1) ? CurrentTheme.Line(i) : linestyle);
+  obj->SetMarkerColor(c);
+  obj->SetLineColor(c);
+  obj->SetMarkerSize(size);
+  obj->SetLineWidth(size);
+}
+
+Plotting::DrawOpt Plotting::ParseDrawOption(TString opt, DrawnKind kind){
+  DrawOpt o;
+  TString lower = opt;
+  lower.ToLower();
+  switch(kind){
+    case kHistKind:
+    case kRatioKind:
+      //  Lines and curves are only drawn as such when you add "hist" to the DrawOption
+      o.draw = (opt == "l" || opt == "c") ? opt+" hist" : opt;
+      o.line = opt.Contains("h");
+      if(kind == kHistKind) o.legend = LegendDrawOption(o.draw);
+      else o.legend = (o.draw.Contains("l") || o.draw.Contains("hist")) ? "l" : "p";
+      break;
+    case kGraphKind:
+      o.draw = opt;
+      o.line = opt.Contains("l");
+      o.legend = LegendDrawOption(opt);
+      o.straight = lower.Contains("l") && !lower.Contains("p") && !lower.Contains("*") && !lower.Contains("c") && !lower.Contains("b") && !lower.Contains("f");
+      break;
+    case kFuncKind:
+      o.draw = opt;
+      o.legend = (opt.Contains("l") || opt.Contains("hist") || opt.Contains("C")) ? "l" : "p";
+      o.straight = !lower.Contains("p") && !lower.Contains("*") && !lower.Contains("f") && !lower.Contains("b") && !lower.Contains("e");
+      break;
+    case kMapKind:
+      o.draw = opt;
+      break;
+  }
+  return o;
 }
 
 TString Plotting::LegendDrawOption(TString UserDrawOpt){
@@ -275,28 +2855,98 @@ class Plotting1D : public Plotting{
     //  After adding all histograms, functions and graph using the New.. functions create the actual plot
     void Plot(TString name = "dummy.pdf", Bool_t logx = false, Bool_t logy = false);
 
-    //  Add a histogram to the hists vector and put all its settings into different vectors
-    void NewHist(TH1F* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
-
-    //  This entire macro is written for TH1Fs because you cant see the difference and it takes half the memory.
-    //  If given a TH1D just convert it to a TH1F and give it to the other NewHist function
-    void NewHist(TH1D* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+    //  Add a histogram to the hists vector and put all its settings into different vectors.
+    //  Any 1D type (TH1F, TH1D, TH1I, TProfile, ...) is plotted as it is, nothing is copied or converted
+    void NewHist(TH1* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
 
     //  Add a new function/graph to the funcs/graphs vector that will be drawn when calling Plot()
     void NewFunc(TF1* f = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "l");
     void NewGraph(TGraph* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
 
+    //  Add the band of the variations of nominal (e.g. systematic variations) as a single translucent filled band with one legend entry (see BandMode).
+    //  It is computed by every Plot() in one pass over the bin arrays, the variations themselves are not drawn. Add it before the hists it should be behind
+    void NewBand(TH1* nominal, std::vector<TH1*> variations, TString label = "", Int_t color = -1, BandMode mode = kEnvelope);
+
+    //  Stack the components (the first at the bottom) as filled hists in the colors of the theme, with labels[i] as legend entry of component i.
+    //  The cumulative sums are computed by every Plot() with one prefix sum over the bin arrays, nothing is cloned. The axis ranges follow the total,
+    //  which is returned (owned by the plotting object), e.g. as denominator of a ratio. Add the stack before the hists that should be drawn on top of it
+    TH1* NewStack(std::vector<TH1*> components, std::vector<TString> labels = {});
+
+    //  Same as above with the object key in file. It is only read when Plot() is called (see PlottingFileCache), so many plots can be set up
+    //  without holding their data, and plots sharing a file or an object open and read it only once. Each plot styles its own copy of a shared object
+    void NewHist(TString file, TString key, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+    void NewGraph(TString file, TString key, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+
     //  Store the user wishes for labels and offsets in the AxisLabel and AxisLabelOffset attributes. They will later be used in InitializeAxis.
     void SetAxisLabel(TString labelx = "", TString labely = "", Double_t offsetx = 1., Double_t offsety = 1.);
 
+    //  Draw graphs that are only drawn as lines (e.g. "l") with a copy that keeps the first, lowest, highest and last point of every pixel column of the final x range (log x aware).
+    //  The drawn line is the same, but huge graphs (waveforms, time series) are written much faster and give small files. oversampling > 1 uses finer columns, e.g. for zooming into pdfs.
+    void SetDecimation(Bool_t decimate = true, Double_t oversampling = 1);
+
+    //  Write svg files directly from the hists, graphs, funcs, lines, latex and legend (see PlottingFastImage) instead of painting a TCanvas
+    //  and saving it. Many times faster and without ROOTs graphics, for dashboards and other bulk output of simple plots. The look follows the
+    //  TCanvas closely but not exactly: only the common draw options are understood (p, e, e1, e2, e3, h/hist, l, c, f, x), text is a subset
+    //  of latex and SetRaster does not apply. Plots with other formats, plots into an open book and PlottingGrid panels still use the TCanvas
+    void SetFastOutput(Bool_t fast = true);
+
   private:
 
+    Bool_t Decimate = false;  //  Set by SetDecimation
+    Double_t DecimationOversampling = 1;
+
+    Bool_t FastOutput = false;  //  Set by SetFastOutput
+
+    //  Maps axis coordinates to pixels of the fast output
+    struct FastFrame{
+      Double_t pixels[2][2];  //  Left and right, lower and upper border of the frame
+      Double_t range[2][2]; //  The AxisRange, as log10 for log axes
+      Bool_t log[2];
+      Double_t Map(Int_t axis, Double_t value) const; //  NaN for values <= 0 on log axes
+      Double_t Low(Int_t axis) const;
+      Double_t Up(Int_t axis) const;
+    };
+
+    //  True if SetFastOutput is on and every file of name is svg
+    Bool_t UseFastOutput(TString name);
+
+    //  Plot() with the fast output. Draws in the same order as Plot() and with the same phases
+    void PlotFast(TString name, Bool_t logx, Bool_t logy, Profiler &profile);
+
+    //  Write image to all files. Returns the first file that could not be written (empty if all were written)
+    static TString WriteFastImage(const PlottingFastImage &image, const std::vector<TString> &files);
+
+    //  Frame, ticks, labels and titles, then the objects and the legend of the fast output
+    void FastAxes(PlottingFastImage &image, const FastFrame &frame);
+    void FastHist(PlottingFastImage &image, const FastFrame &frame, TH1* h, const DrawOpt &opt);
+    void FastGraph(PlottingFastImage &image, const FastFrame &frame, TGraph* g, const DrawOpt &opt);
+    void FastFunc(PlottingFastImage &image, const FastFrame &frame, TF1* f);
+    void FastLegend(PlottingFastImage &image);
+
+    //  Tick positions of an axis from low to up with the labels of the major ticks. Linear axes get at most 10 divisions of 1, 2 or 5 times a power
+    //  of ten. Labels with more than maxdigits digits are divided by a power of ten that is returned in factor (like TAxis::SetMaxDigits)
+    static void FastTicks(Double_t low, Double_t up, Bool_t log, Int_t maxdigits, std::vector<Double_t> &major, std::vector<Double_t> &minor,
+                          std::vector<TString> &labels, TString &factor);
+
+    //  0xAARRGGBB of a ROOT color
+    static UInt_t FastColor(Color_t color);
+
     //  Create the canvas using the standard dimensions and margins, if they were not set by SetMargins
     void InitializeCanvas(Bool_t logx, Bool_t logy);
 
-    //  Create the hdummy that will be plotted first and give it the Set xis ranges and labels
+    //  Create the frame hDummy that will be plotted first and give it the Set axis ranges and labels
     void InitializeAxis(Bool_t logy);
 
+    //  Autoset the ranges again and move the axes of the existing hDummy to them (persistent mode)
+    void UpdateAxis(Bool_t logy);
+
+    //  Returns the decimated copy of g (owned by the plot) if decimation is on and g qualifies, g itself otherwise. Needs the final AxisRange.
+    //  scale is the number of pixels per canvas pixel of the target (> 1 for raster mode)
+    TGraph* DecimateGraph(TGraph* g, const DrawOpt &opt, Bool_t logx, Double_t scale = 1);
+
+    //  Raster mode: paint all graphs as a bitmap into the frame
+    void RasterizeGraphs(Bool_t logx, Bool_t logy);
+
 };
 
 Plotting1D::Plotting1D(){
@@ -309,93 +2959,173 @@ Plotting1D::~Plotting1D(){
 
 void Plotting1D::Plot(TString name, Bool_t logx, Bool_t logy){
 
+  Profiler profile(this, "Plotting1D", name); //  Times the phases if profiling is enabled
+  if(!HostPad) Prepare(); //  Read the objects given by file and key, compute stacks and bands (the grid did it for its panels)
+
   if(hists.size() < 1 && graphs.size() < 1 && funcs.size() < 1) Abort("No hists added for plotting.");
 
+  //  Nothing to do if the files were already written from the same input (see SetCache)
+  Bool_t cache = CacheActive();
+  Fingerprint fp;
+  if(cache){
+    fp = BaseFingerprint(name, logx + 2*logy);
+    fp.Add(Decimate);
+    fp.Add(DecimationOversampling);
+    fp.Add(FastOutput);
+    if(CacheHit(name, fp)) { profile.Result("cached"); return; }
+  }
+
+  //  svg without a TCanvas (see SetFastOutput)
+  if(UseFastOutput(name)){
+    PlotFast(name, logx, logy, profile);
+    if(cache) CacheStore(name, fp);
+    return;
+  }
+
+  //  A persistent canvas that still shows the current scene only needs new axis ranges if the data changed
+  std::vector<Double_t> signature;
+  if(Persistent){
+    signature = DataSignature();
+    //  Decimated and rasterized graphs are copies and would not follow their originals, so then changed data needs a new scene
+    Bool_t copiesChanged = (((Decimate || Raster) && graphs.size() > 0) || (FuncSampling && funcs.size() > 0)) && signature != LastSignature;
+    if(Canvas && !SceneChanged && LastLogs == logx + 2*logy && !copiesChanged){
+      if(signature == LastSignature && name == LastName && !BookName.Length() && !MemoryOutput) { profile.Result("unchanged"); return; } //  Exactly this plot has already been written
+      profile.Result("updated");
+      profile.Phase(kAxisPhase);
+      if(signature != LastSignature) UpdateAxis(logy);
+      profile.Phase(kExportPhase);
+      Export(name);
+      if(cache) CacheStore(name, fp);
+      KeepScene(name, logx + 2*logy, signature);
+      return;
+    }
+  }
+
+  profile.Phase(kCanvasPhase);
   InitializeCanvas(logx, logy); //  Creating Canvas with margins
+  profile.Phase(kAxisPhase);
   InitializeAxis(logy); //  Create the hDummy and set its axis label + ranges
   hDummy->Draw(); //  Draw the just set axis (label) on the Canvas
 
-  InitializeLegend(); //  Create leg and set its dimensions + format
+  profile.Phase(kDrawPhase);
+  Bool_t raster = Raster && graphs.size() > 0;
+  if(raster) RasterizeGraphs(logx, logy); //  The bitmap is opaque, so everything else is drawn on top of it
 
-  //  Loop thru all elements of all vectors and plot them on top of the empty hDummy and add them to leg
+  //  Loop thru all elements of all vectors and plot them on top of the empty hDummy
   //----------------------------------------------------------------------------
   for( Int_t i = 0; i < (Int_t)lines.size(); ++i) lines.at(i)->Draw("same");
 
   for( Int_t i = 0; i < (Int_t)clines.size(); ++i) clines.at(i)->Draw("same");
 
   for( Int_t i = 0; i < (Int_t)graphs.size(); ++i){
-    graphs.at(i)->Draw(Form("same %s", ((TString) DrawOptionG.at(i)).Data()));
+    TGraph *drawn = raster ? graphs.at(i) : DecimateGraph(graphs.at(i), DrawOptionG.at(i), logx);
+    if(!raster) drawn->Draw(Form("same %s", DrawOptionG.at(i).draw.Data()));
+    profile.Count(drawn);
+  } //  The legend keeps the original graph, it has the same attributes
+
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i){
+    hists.at(i)->Draw(Form("same %s", DrawOption.at(i).draw.Data()));
+    profile.Count(hists.at(i));
+  }
+
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){
+    if(FuncSampling && DrawOptionF.at(i).straight){ //  The legend keeps the function, it has the same line
+      TGraph *sampled = SampledFunc(funcs.at(i), Canvas, AxisRange[1][0], AxisRange[1][1], logx, logy);
+      if(sampled->GetN() > 0) sampled->Draw("same l");
+      profile.Count(sampled);
+      continue;
+    }
+    funcs.at(i)->Draw(Form("same %s", DrawOptionF.at(i).draw.Data()));
+    profile.Count(funcs.at(i));
   }
 
+  for(  Int_t i = 0; i < (Int_t)Latex.size(); ++i) Latex.at(i)->Draw("same");
+  profile.Count(lines.size() + clines.size() + Latex.size());
+
+  if(raster) Canvas->RedrawAxis(); //  The ticks inside the frame are covered by the bitmap
+  //----------------------------------------------------------------------------
+  //  Now that everything is drawn add all labeled objects to the legend and print it.
+
+  profile.Phase(kLegendPhase);
+  InitializeLegend(); //  Create leg and set its dimensions + format
+
   for( Int_t i = 0; i < (Int_t)hists.size(); ++i){
-    hists.at(i)->Draw(Form("same %s", ((TString) DrawOption.at(i)).Data()));
-    if ((Int_t)*(LegendLabel.at(i).Data())) leg->AddEntry(hists.at(i), LegendLabel.at(i).Data(), LegendDrawOption(DrawOption.at(i)));
+    if ((Int_t)*(LegendLabel.at(i).Data())) leg->AddEntry(hists.at(i), LegendLabel.at(i).Data(), DrawOption.at(i).legend);
   } //  Dont add anything to the legend if LegendLabel is empty
 
   for( Int_t i = 0; i < (Int_t)graphs.size(); ++i){
-    if ((Int_t)*(LegendLabelG.at(i).Data())) leg->AddEntry(graphs.at(i), LegendLabelG.at(i).Data(), LegendDrawOption(DrawOptionG.at(i)).Data());
+    if ((Int_t)*(LegendLabelG.at(i).Data())) leg->AddEntry(graphs.at(i), LegendLabelG.at(i).Data(), DrawOptionG.at(i).legend);
   }
 
   for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){
-    funcs.at(i)->Draw(Form("same %s", ((TString) DrawOptionF.at(i)).Data()));
-    if ((Int_t)*(LegendLabelF.at(i).Data())) leg->AddEntry(funcs.at(i), LegendLabelF.at(i).Data(), (DrawOptionF.at(i).Contains("l") || DrawOptionF.at(i).Contains("hist") || DrawOptionF.at(i).Contains("C") ) ? "l" : "p");
-  } //  Dont add anything to the legend if LegendLabelF is empty
-
+    if ((Int_t)*(LegendLabelF.at(i).Data())) leg->AddEntry(funcs.at(i), LegendLabelF.at(i).Data(), DrawOptionF.at(i).legend);
+  }
 
   for( Int_t i = 0; i < (Int_t)lines.size(); ++i){
     if ((Int_t)*(LegendLabelL.at(i).Data())) leg->AddEntry(lines.at(i), LegendLabelL.at(i).Data(),"l");
   }
 
-  for(  Int_t i = 0; i < (Int_t)Latex.size(); ++i) Latex.at(i)->Draw("same");
-  //----------------------------------------------------------------------------
-  //  Now that everything is drawn just add the legend and print it.
-
   leg->Draw("same");
-  Canvas->SaveAs(name);
-  delete hDummy;
-  delete Canvas;
+
+  profile.Phase(kExportPhase);
+  Export(name);
+  if(cache) CacheStore(name, fp);
+  if(Persistent) KeepScene(name, logx + 2*logy, signature);
+  else CleanUp();
 }
 
-void Plotting1D::NewHist(TH1F* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+void Plotting1D::NewHist(TH1* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!h) Abort("NewHist was given a Nullptr.");
+  if(h->GetDimension() != 1) Abort("NewHist was given a hist with more than one dimension.");
+  SceneChanged = true;
 
   hists.push_back(h);
   LegendLabel.push_back(label);
-  //  Lines and curves are only drawn as such when you add "hist" to the DrawOption
-  DrawOption.push_back( (opt == "l" || opt == "c") ? opt+" hist" : opt );
+  DrawOption.push_back(ParseDrawOption(opt, kHistKind));
   h->SetStats(0);
 
-  h->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
   //  LineStyles > 10 make root crash. If its not drawn in hist style, the errors are the only lines and should be style 1
-  h->SetLineStyle( (opt.Contains("h") && style < 10) ? style : 1 );
-  h->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  h->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  h->SetMarkerSize(size);
-  h->SetLineWidth(size);
+  ApplyStyle(h, counter, label, style, size, color, (DrawOption.back().line && style < 10 && style != -1) ? style : 1);
 
   counter++;  //  Make sure the next histogram has different colors and styles
 }
 
-void Plotting1D::NewHist(TH1D* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
-  TH1F* hd = (TH1F*)h;
-  NewHist(hd, label, style, size, color, opt);
+void Plotting1D::NewBand(TH1* nominal, std::vector<TH1*> variations, TString label, Int_t color, BandMode mode){
+  ComputedBands.push_back(NewComputedBand(nominal, variations, mode, false));
+  TH1D *band = ComputedBands.back().band;
+  NewHist(band, label, -1, 1, color, "E2");
+  StyleBand(band);
+  DrawOption.back().legend = "f";
+}
+
+TH1* Plotting1D::NewStack(std::vector<TH1*> components, std::vector<TString> labels){
+  ComputedStacks.push_back(NewComputedStack(components));
+  ComputedStack &stack = ComputedStacks.back();
+  ComputeStack(stack);  //  The total can be used right away
+
+  //  The total is drawn first. Component i still gets theme entry i, as if the components were added one after the other
+  Int_t first = counter;
+  for( Int_t i = (Int_t)stack.layers.size() - 1; i >= 0; --i){
+    counter = first + i;
+    NewHist(stack.layers.at(i), i < (Int_t)labels.size() ? labels.at(i) : "", -1, 1, -1, "hist");
+    StyleLayer(stack.layers.at(i));
+    DrawOption.back().legend = "f";
+  }
+  counter = first + stack.layers.size();
+  return stack.layers.back();
 }
 
 void Plotting1D::NewFunc(TF1* f, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!f) Abort("NewFunc was given a Nullptr.");
+  SceneChanged = true;
 
   funcs.push_back(f);
   LegendLabelF.push_back(label);
-  DrawOptionF.push_back(opt);
+  DrawOptionF.push_back(ParseDrawOption(opt, kFuncKind));
 
-  f->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
-  f->SetLineStyle(( style == -1) ? AutoStyleLine[counter] : style);
-  f->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetMarkerSize(size);
-  f->SetLineWidth(size);
+  ApplyStyle(f, counter, label, style, size, color, style);
 
   counter++;
 }
@@ -403,34 +3133,139 @@ void Plotting1D::NewFunc(TF1* f, TString label, Int_t style, Int_t size, Int_t c
 void Plotting1D::NewGraph(TGraph* g, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!g) Abort("NewGraph was given a Nullptr.");
+  SceneChanged = true;
 
   graphs.push_back(g);
   LegendLabelG.push_back(label);
-  DrawOptionG.push_back(opt);
+  DrawOptionG.push_back(ParseDrawOption(opt, kGraphKind));
+
+  ApplyStyle(g, counter, label, style, size, color, (DrawOptionG.back().line && style < 10 && style != -1) ? style : 1);
+
+  counter++;
+}
+
+void Plotting1D::NewHist(TString file, TString key, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+  SceneChanged = true;
+
+  LegendLabel.push_back(label);
+  DrawOption.push_back(ParseDrawOption(opt, kHistKind));
+  NewLazy(file, key, hists, DrawOption, counter, label, style, size, color);
+
+  counter++;
+}
+
+void Plotting1D::NewGraph(TString file, TString key, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+  SceneChanged = true;
 
-  g->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
-  g->SetLineStyle( (opt.Contains("l") && style < 10) ? style : 1 );
-  g->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  g->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  g->SetMarkerSize(size);
-  g->SetLineWidth(size);
+  LegendLabelG.push_back(label);
+  DrawOptionG.push_back(ParseDrawOption(opt, kGraphKind));
+  NewLazy(file, key, graphs, DrawOptionG, counter, label, style, size, color);
 
   counter++;
 }
 
+void Plotting1D::SetDecimation(Bool_t decimate, Double_t oversampling){
+  SceneChanged = true;
+  Decimate = decimate;
+  DecimationOversampling = oversampling > 0 ? oversampling : 1;
+}
+
+TGraph* Plotting1D::DecimateGraph(TGraph* g, const DrawOpt &opt, Bool_t logx, Double_t scale){
+
+  //  Only plain TGraphs drawn as straight lines: markers, error bars, smoothed curves, bars and fill areas would look different
+  if(!Decimate || g->IsA() != TGraph::Class() || !opt.straight) return g;
+
+  //  Pixel columns of the frame. Keeping 4 points per column only pays off for much larger graphs
+  Int_t columns = (Int_t)(CanvasDimensions[0]*(1 - CanvasMargins[0][0] - CanvasMargins[0][1])*DecimationOversampling*scale);
+  Int_t n = g->GetN();
+  if(columns < 1 || n <= 4*(columns + 2)) return g;
+
+  Bool_t uselog = logx && AxisRange[0][0] > 0;
+  Double_t ulow = uselog ? log10(AxisRange[0][0]) : AxisRange[0][0];
+  Double_t uup = uselog ? log10(AxisRange[0][1]) : AxisRange[0][1];
+  if(!(uup > ulow)) return g;
+  Double_t perunit = columns/(uup - ulow);
+
+  const Double_t *x = g->GetX();
+  const Double_t *y = g->GetY();
+  std::vector<Double_t> dx, dy;
+  dx.reserve(4*(columns + 2));
+  dy.reserve(4*(columns + 2));
+
+  //  Points left and right of the x range are collected in the columns -1 and columns, so the lines into the frame keep their slope
+  Int_t current = -2;
+  Int_t keep[4] = {0, 0, 0, 0}; //  first, lowest, highest, last point of the current column
+  auto flush = [&](){
+    std::sort(keep, keep + 4);
+    for( Int_t k = 0; k < 4; ++k){
+      if(k > 0 && keep[k] == keep[k-1]) continue;
+      dx.push_back(x[keep[k]]);
+      dy.push_back(y[keep[k]]);
+    }
+  };
+  for( Int_t i = 0; i < n; ++i){
+    if(i > 0 && x[i] < x[i-1]) return g;  //  Unsorted points: a column would not be one piece of the line
+    Int_t column;
+    if(x[i] < AxisRange[0][0]) column = -1;
+    else if(x[i] > AxisRange[0][1]) column = columns;
+    else column = std::min((Int_t)(((uselog ? log10(x[i]) : x[i]) - ulow)*perunit), columns - 1);
+
+    if(column != current){
+      if(current != -2) flush();
+      current = column;
+      keep[0] = keep[1] = keep[2] = keep[3] = i;
+      continue;
+    }
+    if(y[i] < y[keep[1]]) keep[1] = i;
+    if(y[i] > y[keep[2]]) keep[2] = i;
+    keep[3] = i;
+  }
+  flush();
+
+  TGraph *d = Own(new TGraph((Int_t)dx.size(), dx.data(), dy.data()));
+  d->SetName(UniqueName(Form("%s_decimated", g->GetName())));
+  g->TAttLine::Copy(*d);
+  g->TAttFill::Copy(*d);
+  g->TAttMarker::Copy(*d);
+  return d;
+}
+
+void Plotting1D::RasterizeGraphs(Bool_t logx, Bool_t logy){
+
+  //  Markers and lines are given in pixels, so they are enlarged on the finer raster and reset once it is painted
+  std::vector<TGraph*> drawn;
+  std::vector<Size_t> markersizes;
+  std::vector<Width_t> linewidths;
+  RasterizeFrame(AxisRange[0][0], AxisRange[0][1], AxisRange[1][0], AxisRange[1][1], logx, logy, false, [&](Double_t scale){
+    for( Int_t i = 0; i < (Int_t)graphs.size(); ++i){
+      TGraph *g = DecimateGraph(graphs.at(i), DrawOptionG.at(i), logx, scale);
+      drawn.push_back(g);
+      markersizes.push_back(g->GetMarkerSize());
+      linewidths.push_back(g->GetLineWidth());
+      g->SetMarkerSize(g->GetMarkerSize()*scale);
+      g->SetLineWidth(std::max(1, (Int_t)(g->GetLineWidth()*scale + 0.5)));
+      g->Draw(Form("same %s", DrawOptionG.at(i).draw.Data()));
+    }
+  });
+  for( Int_t i = 0; i < (Int_t)drawn.size(); ++i){
+    drawn.at(i)->SetMarkerSize(markersizes.at(i));
+    drawn.at(i)->SetLineWidth(linewidths.at(i));
+  }
+}
+
 void Plotting1D::InitializeCanvas(Bool_t logx, Bool_t logy){
 
-  if(Canvas) delete Canvas; //  This should never happen, but better safe than sorry.
+  if(Canvas) CleanUp(); //  This should never happen, but better safe than sorry.
 
-  Canvas = new TCanvas("Canvas", "Canvas", CanvasDimensions[0], CanvasDimensions[1]);
+  Canvas = NewCanvas(CanvasDimensions[0], CanvasDimensions[1]);
   Canvas->SetLeftMargin(CanvasMargins[0][0]);
   Canvas->SetRightMargin(CanvasMargins[0][1]);
   Canvas->SetBottomMargin(CanvasMargins[1][0]);
   Canvas->SetTopMargin(CanvasMargins[1][1]);
 
   //  Set ticks at regular intervals on every edge of the histogram (also right and top)
-  gPad->SetTickx();
-  gPad->SetTicky();
+  Canvas->SetTickx();
+  Canvas->SetTicky();
 
   Canvas->cd();
   Canvas->SetLogx(logx);
@@ -438,29 +3273,534 @@ void Plotting1D::InitializeCanvas(Bool_t logx, Bool_t logy){
 }
 
 void Plotting1D::SetAxisLabel(TString labelx, TString labely, Double_t offsetx , Double_t offsety){
+  SceneChanged = true;
   AxisLabel[0] = labelx;
   AxisLabel[1] = labely;
   AxisLabelOffset[0] = offsetx;
   AxisLabelOffset[1] = offsety;
 }
 
-void Plotting1D::InitializeAxis(Bool_t logy){
+void Plotting1D::UpdateAxis(Bool_t logy){
+  ResetAxisRange();
+  AutoSetAxisRanges(logy);
+  hDummy->GetXaxis()->SetLimits(AxisRange[0][0], AxisRange[0][1]);
+  hDummy->GetYaxis()->SetLimits(AxisRange[1][0], AxisRange[1][1]);
+  Canvas->Modified();
+  Canvas->Update();
+}
+
+void Plotting1D::InitializeAxis(Bool_t logy){
+
+  AutoSetAxisRanges(logy);  //  If any AxisRanges are still set to 42 -> Autoset them
+
+  hDummy = Own(NewFrame("hDummy", AxisRange[0][0], AxisRange[0][1], AxisRange[1][0], AxisRange[1][1]));
+
+  hDummy->GetXaxis()->SetTitle(AxisLabel[0]);
+  hDummy->GetYaxis()->SetTitle(AxisLabel[1]);
+  hDummy->GetYaxis()->SetTitleFont(62);
+  hDummy->GetXaxis()->SetTitleFont(62);
+  hDummy->GetXaxis()->SetTitleOffset(AxisLabelOffset[0]);
+  hDummy->GetYaxis()->SetTitleOffset(AxisLabelOffset[1]);
+  hDummy->GetYaxis()->SetMaxDigits(3);
+}
+
+void Plotting1D::SetFastOutput(Bool_t fast){
+  SceneChanged = true;
+  FastOutput = fast;
+}
+
+Bool_t Plotting1D::UseFastOutput(TString name){
+  if(!FastOutput || HostPad || BookName.Length() || OutputDirectory) return false;
+  std::vector<TString> files = OutputFiles(name);
+  if(files.size() < 1) return false;
+  for( Int_t i = 0; i < (Int_t)files.size(); ++i){
+    if(!files.at(i).EndsWith(".svg", TString::kIgnoreCase)) return false;
+  }
+  return true;
+}
+
+Double_t Plotting1D::FastFrame::Map(Int_t axis, Double_t value) const{
+  if(log[axis]){
+    if(value <= 0) return std::numeric_limits<Double_t>::quiet_NaN();
+    value = log10(value);
+  }
+  Double_t pixel = pixels[axis][0] + (value - range[axis][0])/(range[axis][1] - range[axis][0])*(pixels[axis][1] - pixels[axis][0]);
+  return std::max(-1e6, std::min(pixel, 1e6)); //  Far outside the image, but short enough to be written
+}
+
+Double_t Plotting1D::FastFrame::Low(Int_t axis) const{
+  return log[axis] ? pow(10, range[axis][0]) : range[axis][0];
+}
+
+Double_t Plotting1D::FastFrame::Up(Int_t axis) const{
+  return log[axis] ? pow(10, range[axis][1]) : range[axis][1];
+}
+
+UInt_t Plotting1D::FastColor(Color_t color){
+  std::lock_guard<std::recursive_mutex> lock(OutputMutex); //  The list of colors is global and grows when themes add colors
+  TColor *c = gROOT->GetColor(color);
+  if(!c) return 0xff000000;
+  return ((UInt_t)(c->GetAlpha()*255 + 0.5) << 24) | ((UInt_t)(c->GetRed()*255 + 0.5) << 16) | ((UInt_t)(c->GetGreen()*255 + 0.5) << 8) | (UInt_t)(c->GetBlue()*255 + 0.5);
+}
+
+void Plotting1D::PlotFast(TString name, Bool_t logx, Bool_t logy, Profiler &profile){
+
+  if(Canvas) CleanUp(); //  The canvas of an earlier persistent Plot()
+
+  profile.Phase(kCanvasPhase);
+  Int_t w = CanvasDimensions[0];
+  Int_t h = CanvasDimensions[1];
+  Double_t s = std::min(w, h); //  ROOT text sizes are fractions of the shorter side of the canvas
+  PlottingFastImage image(w, h);
+
+  profile.Phase(kAxisPhase);
+  AutoSetAxisRanges(logy);
+  FastFrame frame;
+  frame.pixels[0][0] = CanvasMargins[0][0]*w;
+  frame.pixels[0][1] = (1 - CanvasMargins[0][1])*w;
+  frame.pixels[1][0] = (1 - CanvasMargins[1][0])*h;
+  frame.pixels[1][1] = CanvasMargins[1][1]*h;
+  Bool_t logs[2] = {logx, logy};
+  for( Int_t a = 0; a < 2; ++a){
+    frame.log[a] = logs[a] && AxisRange[a][1] > 0;
+    Double_t low = AxisRange[a][0];
+    if(frame.log[a] && low <= 0) low = 1e-3*AxisRange[a][1];  //  A log axis can't start at 0
+    frame.range[a][0] = frame.log[a] ? log10(low) : low;
+    frame.range[a][1] = frame.log[a] ? log10(AxisRange[a][1]) : AxisRange[a][1];
+    if(!(frame.range[a][1] > frame.range[a][0])) frame.range[a][1] = frame.range[a][0] + 1;
+  }
+  FastAxes(image, frame);
+
+  profile.Phase(kDrawPhase);
+  for( Int_t i = 0; i < (Int_t)lines.size(); ++i){
+    TLine *l = lines.at(i);
+    image.Line({frame.Map(0, l->GetX1()), frame.Map(0, l->GetX2())}, {frame.Map(1, l->GetY1()), frame.Map(1, l->GetY2())},
+               FastColor(l->GetLineColor()), l->GetLineWidth(), l->GetLineStyle());
+  }
+
+  //  Curly lines become waves of their wavelength and amplitude
+  for( Int_t i = 0; i < (Int_t)clines.size(); ++i){
+    TCurlyLine *c = clines.at(i);
+    Double_t x0 = frame.Map(0, c->GetStartX()), y0 = frame.Map(1, c->GetStartY());
+    Double_t dx = frame.Map(0, c->GetEndX()) - x0, dy = frame.Map(1, c->GetEndY()) - y0;
+    Double_t length = sqrt(dx*dx + dy*dy);
+    Double_t wave = c->GetWaveLength()*s;
+    if(!(length > 0) || !(wave > 0)) continue;
+    Int_t n = std::min(100000, std::max(2, (Int_t)(16*length/wave)));
+    std::vector<Double_t> x(n + 1), y(n + 1);
+    for( Int_t k = 0; k <= n; ++k){
+      Double_t t = (Double_t)k/n;
+      Double_t offset = c->GetAmplitude()*s*sin(2*TMath::Pi()*t*length/wave);
+      x[k] = x0 + t*dx - dy/length*offset;
+      y[k] = y0 + t*dy + dx/length*offset;
+    }
+    image.Line(x, y, FastColor(c->GetLineColor()), c->GetLineWidth());
+  }
+
+  image.Clip(frame.pixels[0][0], frame.pixels[1][1], frame.pixels[0][1], frame.pixels[1][0]);
+  for( Int_t i = 0; i < (Int_t)graphs.size(); ++i){
+    TGraph *drawn = DecimateGraph(graphs.at(i), DrawOptionG.at(i), logx);
+    FastGraph(image, frame, drawn, DrawOptionG.at(i));
+    profile.Count(drawn);
+  }
+
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i){
+    FastHist(image, frame, hists.at(i), DrawOption.at(i));
+    profile.Count(hists.at(i));
+  }
+
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){
+    FastFunc(image, frame, funcs.at(i));
+    profile.Count(funcs.at(i));
+  }
+  image.Unclip();
+
+  for( Int_t i = 0; i < (Int_t)Latex.size(); ++i){
+    TLatex *l = Latex.at(i);
+    image.Text(l->GetX()*w, (1 - l->GetY())*h, l->GetTitle(), FastColor(l->GetTextColor()), l->GetTextSize()*s, l->GetTextFont(), l->GetTextAlign(), l->GetTextAngle());
+  }
+  profile.Count(lines.size() + clines.size() + Latex.size());
+
+  profile.Phase(kLegendPhase);
+  FastLegend(image);
+
+  profile.Phase(kExportPhase);
+  std::vector<TString> files = OutputFiles(name);
+  if(MemoryOutput){
+    OutputBuffers.clear();
+    for( Int_t i = 0; i < (Int_t)files.size(); ++i){
+      std::string &bytes = OutputBuffers[files.at(i)];
+      if(!image.EncodeSVG(bytes)) Abort(Form("Could not encode %s.", files.at(i).Data()));
+    }
+  }
+  else if(AsyncQueueSize > 0){
+    //  The image does not refer to any ROOT object, so the writer can encode it while the next plot is built
+    std::shared_ptr<PlottingFastImage> queued = std::make_shared<PlottingFastImage>(std::move(image));
+    Long64_t id = ProfileId;
+    ProfileQueued = true;
+    Enqueue([queued, files, id](){
+      TString failed = WriteFastImage(*queued, files);
+      if(failed.Length()) throw std::runtime_error(Form("Could not write %s.", failed.Data()));
+      if(id) StoreQueuedBytes(id, files);
+    });
+  }
+  else{
+    TString failed = WriteFastImage(image, files);
+    if(failed.Length()) Abort(Form("Could not write %s.", failed.Data()));
+  }
+  CleanUp(); //  Deletes the decimated graphs and restores the axis ranges
+}
+
+TString Plotting1D::WriteFastImage(const PlottingFastImage &image, const std::vector<TString> &files){
+  for( Int_t i = 0; i < (Int_t)files.size(); ++i){
+    if(!image.WriteSVG(files.at(i))) return files.at(i);
+  }
+  return "";
+}
+
+void Plotting1D::FastAxes(PlottingFastImage &image, const FastFrame &frame){
+
+  Double_t s = std::min(CanvasDimensions[0], CanvasDimensions[1]);
+  const Double_t labelsize = 0.035*s; //  ROOTs default label and title size
+  const Double_t titlesize = 0.035*s;
+  const UInt_t black = 0xff000000;
+  Double_t left = frame.pixels[0][0], right = frame.pixels[0][1], bottom = frame.pixels[1][0], top = frame.pixels[1][1];
+
+  image.Line({left, right, right, left, left}, {bottom, bottom, top, top, bottom}, black);
+
+  for( Int_t a = 0; a < 2; ++a){
+    std::vector<Double_t> major, minor;
+    std::vector<TString> labels;
+    TString factor = "";
+    FastTicks(frame.Low(a), frame.Up(a), frame.log[a], a == 0 ? 5 : 3, major, minor, labels, factor); //  InitializeAxis sets 3 digits for y, ROOTs default is 5
+
+    //  Ticks point into the frame and are repeated on the opposite side (SetTickx, SetTicky)
+    Double_t length = 0.03*(a == 0 ? bottom - top : right - left);
+    for( Int_t k = 0; k < (Int_t)(major.size() + minor.size()); ++k){
+      Bool_t ismajor = k < (Int_t)major.size();
+      Double_t p = frame.Map(a, ismajor ? major.at(k) : minor.at(k - major.size()));
+      Double_t l = ismajor ? length : length/2;
+      if(a == 0){
+        image.Line({p, p}, {bottom, bottom - l}, black);
+        image.Line({p, p}, {top, top + l}, black);
+      }
+      else{
+        image.Line({left, left + l}, {p, p}, black);
+        image.Line({right, right - l}, {p, p}, black);
+      }
+    }
+
+    for( Int_t k = 0; k < (Int_t)labels.size(); ++k){
+      Double_t p = frame.Map(a, major.at(k));
+      if(a == 0) image.Text(p, bottom + 0.015*s, labels.at(k), black, labelsize, 42, 23);
+      else image.Text(left - 0.01*s, p, labels.at(k), black, labelsize, 42, 32);
+    }
+    if(factor.Length()){
+      if(a == 0) image.Text(right, bottom + 0.015*s, factor, black, labelsize, 42, 13);
+      else image.Text(left, top - 0.005*s, factor, black, labelsize, 42, 11);
+    }
+  }
+
+  //  Titles at the end of their axis like ROOTs, moved away from the axis by the offsets of SetAxisLabel
+  image.Text(right, bottom + 0.055*s*AxisLabelOffset[0], AxisLabel[0], black, titlesize, 62, 33);
+  image.Text(left - 0.08*s*AxisLabelOffset[1], top, AxisLabel[1], black, titlesize, 62, 31, 90);
+}
+
+void Plotting1D::FastTicks(Double_t low, Double_t up, Bool_t log, Int_t maxdigits, std::vector<Double_t> &major, std::vector<Double_t> &minor,
+                           std::vector<TString> &labels, TString &factor){
+
+  //  Log axes over at least two powers of ten: ticks at the powers and their multiples. Over many powers only every n-th is labeled
+  if(log){
+    Int_t first = (Int_t)std::ceil(log10(low) - 1e-9);
+    Int_t last = (Int_t)std::floor(log10(up) + 1e-9);
+    if(last > first){
+      Int_t stride = (last - first)/10 + 1;
+      for( Int_t k = first - 1; k <= last; ++k){
+        Double_t decade = pow(10, k);
+        if(k >= first && (k - first) % stride == 0){
+          major.push_back(decade);
+          labels.push_back(k == 0 ? TString("1") : (k == 1 ? TString("10") : TString::Format("10^{%d}", k)));
+        }
+        else if(k >= first) minor.push_back(decade);
+        if(stride > 1) continue;
+        for( Int_t m = 2; m < 10; ++m){
+          if(m*decade >= low && m*decade <= up) minor.push_back(m*decade);
+        }
+      }
+      return;
+    }
+  }
+
+  //  Linear ticks, also for log axes over less than two powers of ten
+  Double_t raw = (up - low)/10;
+  if(!(raw > 0) || std::isinf(raw)) return;
+  Double_t magnitude = pow(10, std::floor(log10(raw)));
+  Double_t norm = raw/magnitude;
+  Int_t multiple = norm <= 1 ? 1 : (norm <= 2 ? 2 : (norm <= 5 ? 5 : 10));
+  Double_t step = multiple*magnitude;
+  Int_t subdivisions = multiple == 2 ? 4 : 5;
+
+  Double_t largest = std::max(std::abs(low), std::abs(up));
+  Int_t exponent = 0;
+  if(largest >= pow(10, maxdigits)){
+    exponent = (Int_t)std::floor(log10(largest));
+    factor = TString::Format("#times10^{%d}", exponent);
+  }
+  Double_t scale = pow(10, -exponent);
+  Int_t decimals = std::max(0, (Int_t)std::ceil(-log10(step*scale) - 1e-9));
+
+  //  At most 11 major and 55 minor ticks. The counter stops the loops where the range is too small for the precision of its values
+  Double_t substep = step/subdivisions;
+  Double_t start = std::ceil(low/substep - 1e-9);
+  for( Int_t k = 0; k < 100 && (start + k)*substep <= up + 1e-9*substep; ++k){
+    Double_t value = (start + k)*substep;
+    if(std::abs(value) < 1e-9*substep) value = 0;  //  No "-0"
+    if(std::fmod(start + k, subdivisions) != 0){
+      minor.push_back(value);
+      continue;
+    }
+    major.push_back(value);
+    labels.push_back(TString::Format("%.*f", decimals, value*scale));
+  }
+}
+
+void Plotting1D::FastHist(PlottingFastImage &image, const FastFrame &frame, TH1* h, const DrawOpt &opt){
+
+  TString d = opt.draw;
+  d.ToLower();
+  Bool_t sumw2 = h->GetSumw2N() > 0;
+  Bool_t curve = d.Contains("l") || d.Contains("c");  //  "l hist" and "c hist": through the bin centers
+  Bool_t markers = d.Contains("p") || d.Contains("*");
+  Bool_t errors = d.Contains("e") || (!d.Length() && sumw2);  //  Without option ROOT draws errors if the hist has them
+  Bool_t boxes = d.Contains("e2");
+  Bool_t band = d.Contains("e3") || d.Contains("e4");
+  Bool_t step = !curve && (d.Contains("h") || (!markers && !errors));
+  Bool_t empty = d.Contains("0"); //  "e0", "p0": also empty bins
+
+  TAxis *axis = h->GetXaxis();
+  Int_t first = std::max(1, axis->FindFixBin(frame.Low(0)));
+  Int_t last = std::min(h->GetNbinsX(), axis->FindFixBin(frame.Up(0)));
+  if(first > last) return;
+
+  //  Hists start and end at 0, or at the lower border of the frame if 0 is not in it. Values <= 0 of log axes are put on the lower border
+  Double_t base = frame.log[1] ? frame.Low(1) : std::min(std::max(0., frame.Low(1)), frame.Up(1));
+  auto clamp = [&](Double_t y){ return frame.log[1] && y <= 0 ? frame.Low(1) : y; };
+
+  UInt_t linecolor = FastColor(h->GetLineColor());
+  UInt_t fillcolor = FastColor(h->GetFillColor());
+  Bool_t filled = h->GetFillStyle() != 0;
+
+  std::vector<Double_t> x, y;
+  if(step){
+    x.push_back(frame.Map(0, axis->GetBinLowEdge(first)));
+    y.push_back(frame.Map(1, base));
+    for( Int_t b = first; b <= last; ++b){
+      Double_t c = frame.Map(1, clamp(h->GetBinContent(b)));
+      x.push_back(frame.Map(0, axis->GetBinLowEdge(b)));
+      x.push_back(frame.Map(0, axis->GetBinUpEdge(b)));
+      y.push_back(c);
+      y.push_back(c);
+    }
+    x.push_back(frame.Map(0, axis->GetBinUpEdge(last)));
+    y.push_back(frame.Map(1, base));
+    if(filled) image.Fill(x, y, fillcolor);
+    image.Line(x, y, linecolor, h->GetLineWidth(), h->GetLineStyle());
+  }
+
+  if(curve){
+    x.clear();
+    y.clear();
+    for( Int_t b = first; b <= last; ++b){
+      x.push_back(frame.Map(0, axis->GetBinCenter(b)));
+      y.push_back(frame.Map(1, clamp(h->GetBinContent(b))));
+    }
+    image.Line(x, y, linecolor, h->GetLineWidth(), h->GetLineStyle());
+  }
+
+  if(errors && (boxes || band)){
+    if(!filled) return;
+    std::vector<Double_t> upper, lower, centers;
+    for( Int_t b = first; b <= last; ++b){
+      Double_t c = h->GetBinContent(b), e = h->GetBinError(b);
+      if(boxes){
+        if(c == 0 && e == 0 && !empty) continue;
+        Double_t x0 = frame.Map(0, axis->GetBinLowEdge(b)), x1 = frame.Map(0, axis->GetBinUpEdge(b));
+        Double_t y0 = frame.Map(1, clamp(c - e)), y1 = frame.Map(1, clamp(c + e));
+        image.Fill({x0, x1, x1, x0}, {y0, y0, y1, y1}, fillcolor);
+      }
+      else{
+        centers.push_back(frame.Map(0, axis->GetBinCenter(b)));
+        upper.push_back(frame.Map(1, clamp(c + e)));
+        lower.push_back(frame.Map(1, clamp(c - e)));
+      }
+    }
+    if(band){
+      x = centers;
+      y = upper;
+      x.insert(x.end(), centers.rbegin(), centers.rend());
+      y.insert(y.end(), lower.rbegin(), lower.rend());
+      image.Fill(x, y, fillcolor);
+    }
+  }
+  else if(errors){
+    //  All error bars are one line item, NaN separates the bars. "e1" adds short lines at their ends
+    Bool_t ends = d.Contains("e1");
+    const Double_t nan = std::numeric_limits<Double_t>::quiet_NaN();
+    x.clear();
+    y.clear();
+    for( Int_t b = first; b <= last; ++b){
+      Double_t c = h->GetBinContent(b), e = h->GetBinError(b);
+      if(c == 0 && e == 0 && !empty) continue;
+      Double_t xc = frame.Map(0, axis->GetBinCenter(b)), yc = frame.Map(1, clamp(c));
+      Double_t y0 = frame.Map(1, clamp(c - e)), y1 = frame.Map(1, clamp(c + e));
+      x.insert(x.end(), {xc, xc, nan, frame.Map(0, axis->GetBinLowEdge(b)), frame.Map(0, axis->GetBinUpEdge(b)), nan});
+      y.insert(y.end(), {y0, y1, nan, yc, yc, nan});
+      if(ends){
+        x.insert(x.end(), {xc - 3, xc + 3, nan, xc - 3, xc + 3, nan});
+        y.insert(y.end(), {y0, y0, nan, y1, y1, nan});
+      }
+    }
+    image.Line(x, y, linecolor, h->GetLineWidth());
+  }
+
+  if(markers){
+    x.clear();
+    y.clear();
+    for( Int_t b = first; b <= last; ++b){
+      Double_t c = h->GetBinContent(b);
+      if(c == 0 && h->GetBinError(b) == 0 && !empty) continue;
+      x.push_back(frame.Map(0, axis->GetBinCenter(b)));
+      y.push_back(frame.Map(1, c));
+    }
+    image.Markers(x, y, FastColor(h->GetMarkerColor()), d.Contains("*") && !d.Contains("p") ? 3 : h->GetMarkerStyle(), h->GetMarkerSize());
+  }
+}
+
+void Plotting1D::FastGraph(PlottingFastImage &image, const FastFrame &frame, TGraph* g, const DrawOpt &opt){
+
+  TString d = opt.draw;
+  d.ToLower();
+  Bool_t fill = d.Contains("f");
+  Bool_t markers = d.Contains("p") || d.Contains("*");
+  Bool_t curve = d.Contains("l") || d.Contains("c") || (!fill && !markers); //  Also bar charts ("b") are drawn as lines
+  Bool_t errors = (g->GetEY() || g->GetEYlow()) && !d.Contains("x");
+
+  Int_t n = g->GetN();
+  const Double_t *gx = g->GetX();
+  const Double_t *gy = g->GetY();
+  std::vector<Double_t> x(n), y(n);
+  for( Int_t i = 0; i < n; ++i){
+    x[i] = frame.Map(0, gx[i]);
+    y[i] = frame.Map(1, gy[i]);
+  }
+
+  if(fill && g->GetFillStyle() != 0) image.Fill(x, y, FastColor(g->GetFillColor()));
+  if(curve) image.Line(x, y, FastColor(g->GetLineColor()), g->GetLineWidth(), g->GetLineStyle());
+
+  if(errors){
+    //  Like the error bars of hists, with short lines at the ends of the y errors
+    auto clamp = [&](Double_t v){ return frame.log[1] && v <= 0 ? frame.Low(1) : v; };
+    const Double_t nan = std::numeric_limits<Double_t>::quiet_NaN();
+    std::vector<Double_t> ex, ey;
+    for( Int_t i = 0; i < n; ++i){
+      if(std::isnan(x[i]) || std::isnan(y[i])) continue;
+      Double_t y0 = frame.Map(1, clamp(gy[i] - g->GetErrorYlow(i))), y1 = frame.Map(1, clamp(gy[i] + g->GetErrorYhigh(i)));
+      if(y0 != y1){
+        ex.insert(ex.end(), {x[i], x[i], nan, x[i] - 2, x[i] + 2, nan, x[i] - 2, x[i] + 2, nan});
+        ey.insert(ey.end(), {y0, y1, nan, y0, y0, nan, y1, y1, nan});
+      }
+      Double_t exl = g->GetErrorXlow(i), exh = g->GetErrorXhigh(i);
+      if(exl > 0 || exh > 0){
+        ex.insert(ex.end(), {frame.Map(0, gx[i] - exl), frame.Map(0, gx[i] + exh), nan});
+        ey.insert(ey.end(), {y[i], y[i], nan});
+      }
+    }
+    image.Line(ex, ey, FastColor(g->GetLineColor()), g->GetLineWidth());
+  }
 
-  if(hDummy) delete hDummy;
+  if(markers) image.Markers(x, y, FastColor(g->GetMarkerColor()), d.Contains("*") && !d.Contains("p") ? 3 : g->GetMarkerStyle(), g->GetMarkerSize());
+}
 
-  AutoSetAxisRanges(logy);  //  If any AxisRanges are still set to 42 -> Autoset them
+void Plotting1D::FastFunc(PlottingFastImage &image, const FastFrame &frame, TF1* f){
 
-  hDummy = new TH2D("hDummy", "hDummy", 1000, AxisRange[0][0], AxisRange[0][1], 1000, AxisRange[1][0], AxisRange[1][1]);
-  hDummy->SetTitle("");
-  hDummy->SetStats(0);
+  if(FuncSampling){
+    FuncSamples &s = SampleFunc(f, frame.Low(0), frame.Up(0), frame.Low(1), frame.Up(1), frame.log[0], frame.log[1],
+                                frame.pixels[0][1] - frame.pixels[0][0], frame.pixels[1][0] - frame.pixels[1][1]);
+    std::vector<Double_t> x(s.x.size()), y(s.y.size());
+    for( Int_t i = 0; i < (Int_t)s.x.size(); ++i){
+      x[i] = frame.Map(0, s.x[i]);
+      y[i] = std::isfinite(s.y[i]) ? frame.Map(1, s.y[i]) : std::numeric_limits<Double_t>::quiet_NaN();  //  Map gives NaN for values <= 0 of log axes
+    }
+    image.Line(x, y, FastColor(f->GetLineColor()), f->GetLineWidth(), f->GetLineStyle());
+    return;
+  }
 
-  hDummy->GetXaxis()->SetTitle(AxisLabel[0]);
-  hDummy->GetYaxis()->SetTitle(AxisLabel[1]);
-  hDummy->GetYaxis()->SetTitleFont(62);
-  hDummy->GetXaxis()->SetTitleFont(62);
-  hDummy->GetXaxis()->SetTitleOffset(AxisLabelOffset[0]);
-  hDummy->GetYaxis()->SetTitleOffset(AxisLabelOffset[1]);
-  hDummy->GetYaxis()->SetMaxDigits(3);
+  //  Sampled at GetNpx() points inside the frame, evenly in the pixels of log axes
+  Double_t low = std::max(f->GetXmin(), frame.Low(0));
+  Double_t up = std::min(f->GetXmax(), frame.Up(0));
+  if(!(up > low)) return;
+  Int_t n = std::max(f->GetNpx(), 2);
+  Double_t u0 = frame.log[0] ? log10(low) : low;
+  Double_t u1 = frame.log[0] ? log10(up) : up;
+
+  std::vector<Double_t> x(n + 1), y(n + 1);
+  for( Int_t i = 0; i <= n; ++i){
+    Double_t u = u0 + (u1 - u0)*i/n;
+    Double_t xi = frame.log[0] ? pow(10, u) : u;
+    Double_t yi = f->Eval(xi);
+    x[i] = frame.Map(0, xi);
+    y[i] = std::isfinite(yi) ? frame.Map(1, yi) : std::numeric_limits<Double_t>::quiet_NaN();
+  }
+  image.Line(x, y, FastColor(f->GetLineColor()), f->GetLineWidth(), f->GetLineStyle());
+}
+
+void Plotting1D::FastLegend(PlottingFastImage &image){
+
+  //  The labeled objects in the order of Plot() with their legend options
+  struct Entry{
+    TString label;
+    TString option;
+    TAttLine *line;
+    TAttMarker *marker;
+    TAttFill *fill;
+  };
+  std::vector<Entry> entries;
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i){
+    if(LegendLabel.at(i).Length()) entries.push_back({LegendLabel.at(i), DrawOption.at(i).legend, hists.at(i), hists.at(i), hists.at(i)});
+  }
+  for( Int_t i = 0; i < (Int_t)graphs.size(); ++i){
+    if(LegendLabelG.at(i).Length()) entries.push_back({LegendLabelG.at(i), DrawOptionG.at(i).legend, graphs.at(i), graphs.at(i), graphs.at(i)});
+  }
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){
+    if(LegendLabelF.at(i).Length()) entries.push_back({LegendLabelF.at(i), DrawOptionF.at(i).legend, funcs.at(i), funcs.at(i), funcs.at(i)});
+  }
+  for( Int_t i = 0; i < (Int_t)lines.size(); ++i){
+    if(LegendLabelL.at(i).Length()) entries.push_back({LegendLabelL.at(i), "l", lines.at(i), nullptr, nullptr});
+  }
+  if(entries.size() < 1) return;
+
+  //  The white box of InitializeLegend with one row per entry. The symbols take the left quarter (TLegends default margin)
+  Double_t w = CanvasDimensions[0], h = CanvasDimensions[1];
+  Double_t x1 = LegendBorders[0][0]*w, x2 = LegendBorders[0][1]*w;
+  Double_t y1 = (1 - LegendBorders[1][1])*h, y2 = (1 - LegendBorders[1][0])*h;
+  image.Fill({x1, x2, x2, x1}, {y1, y1, y2, y2}, 0xffffffff);
+  Double_t row = (y2 - y1)/entries.size();
+  Double_t symbol = 0.25*(x2 - x1);
+
+  for( Int_t k = 0; k < (Int_t)entries.size(); ++k){
+    const Entry &e = entries.at(k);
+    TString o = e.option;
+    o.ToLower();
+    Double_t cx = x1 + symbol/2, cy = y1 + (k + 0.5)*row;
+    if(o.Contains("f") && e.fill && e.fill->GetFillStyle() != 0){
+      image.Fill({x1 + 0.15*symbol, x1 + 0.85*symbol, x1 + 0.85*symbol, x1 + 0.15*symbol}, {cy - 0.35*row, cy - 0.35*row, cy + 0.35*row, cy + 0.35*row},
+                 FastColor(e.fill->GetFillColor()));
+    }
+    if(o.Contains("l") && e.line) image.Line({x1 + 0.1*symbol, x1 + 0.9*symbol}, {cy, cy}, FastColor(e.line->GetLineColor()), e.line->GetLineWidth(), e.line->GetLineStyle());
+    if(o.Contains("e") && e.line) image.Line({cx, cx}, {cy - 0.4*row, cy + 0.4*row}, FastColor(e.line->GetLineColor()), e.line->GetLineWidth());
+    if(o.Contains("p") && e.marker) image.Markers({cx}, {cy}, FastColor(e.marker->GetMarkerColor()), e.marker->GetMarkerStyle(), e.marker->GetMarkerSize());
+    image.Text(x1 + symbol, cy, e.label, 0xff000000, 0.035*std::min(w, h), 42, 12);
+  }
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -468,6 +3808,8 @@ void Plotting1D::InitializeAxis(Bool_t logy){
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 class Plotting2D : public Plotting{
+  friend class PlottingGrid;  //  Applies the palette when the grid is written
+
   public:
 
     Plotting2D(); // This empty constructor always has to be called when plotting 2D
@@ -478,21 +3820,48 @@ class Plotting2D : public Plotting{
     void Plot(TString name = "dummy.pdf", Bool_t logx = false, Bool_t logy = false, Bool_t logz = false, Int_t numcontours = 100);
 
     //  The standard palette is kBird, but there are also other nice 2D plotting styles (https://root.cern.ch/doc/master/classTColor.html)
-    void NewHist(TH2F* h = nullptr, TString opt = "COLZ", Int_t palette = kBird);
-    void NewHist(TH2D* h = nullptr, TString opt = "COLZ", Int_t palette = kBird);  //  Convert to TH2F and call that NewHist function
+    //  Any 2D type (TH2F, TH2D, TH2I, TProfile2D, ...) is plotted as it is
+    void NewHist(TH2* h = nullptr, TString opt = "COLZ", Int_t palette = kBird);
+
+    //  Same with the hist key in file, read when Plot() is called (see Plotting1D::NewHist)
+    void NewHist(TString file, TString key, TString opt = "COLZ", Int_t palette = kBird);
 
     //  Add a new function to the funcs vector that will be drawn when calling Plot()
     void NewFunc(TF1* f = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "l");
 
     void SetAxisLabel(TString labelx = "", TString labely = "", Double_t offsetx = 1., Double_t offsety = 1.);
 
+    //  Draw a temporary copy of the hist that merges neighbouring bins until the visible range has at most one bin per pixel of the frame
+    //  (or maxbinsx/maxbinsy bins, if they are set and smaller). The hist itself is not changed. By default the contents of merged bins are summed,
+    //  with mean = true their average is drawn (for maps of means, efficiencies, ...). Empty (zero) bins do not dilute the average. TProfile2Ds are always
+    //  averaged, weighted with the entries of every bin, and only bins without entries are empty. With log z only positive bins are merged, since the
+    //  others are not drawn at full binning either.
+    void SetAutoRebin(Bool_t rebin = true, Int_t maxbinsx = 0, Int_t maxbinsy = 0, Bool_t mean = false);
+
   protected:
 
-    TH2F* hist = NULL;
+    TH2* hist = NULL;
+
+    Int_t Palette = kBird;  //  Set by NewHist and only applied to gStyle while Plot() writes the file
+
+    //  Settings of SetAutoRebin
+    Bool_t AutoRebin = false;
+    Int_t RebinMaxBins[2] = {0,0};
+    Bool_t RebinMean = false;
 
     void InitializeCanvas(Bool_t logx, Bool_t logy, Bool_t logz);
 
-    void InitializeAxis();
+    //  Set the ranges and labels of the hist h that is drawn first
+    void InitializeAxis(TH2* h);
+
+    //  The hist that is drawn: hist itself or its merged copy (owned by the plot) if AutoRebin is set and the visible range has more bins than allowed
+    TH2* RebinnedHist(Bool_t logz);
+
+    //  True if the z range was changed from the standard 0,2 by SetAxisRange
+    Bool_t HasZRange();
+
+    //  Raster mode: draw a frame with axes and palette and paint the hist drawn into it as a bitmap
+    void DrawRasterized(TH2* drawn, Bool_t logx, Bool_t logy, Bool_t logz, Int_t numcontours);
 
 };
 
@@ -506,74 +3875,118 @@ Plotting2D::~Plotting2D(){
 
 void Plotting2D::Plot(TString name, Bool_t logx, Bool_t logy, Bool_t logz, Int_t numcontours){
 
+  Profiler profile(this, "Plotting2D", name); //  Times the phases if profiling is enabled
+  ResolveLazy(); //  Read the objects given by file and key
+
   if(!hist) Abort("No hist added for plotting.");
 
+  //  Nothing to do if the files were already written from the same input (see SetCache)
+  Bool_t cache = CacheActive();
+  Fingerprint fp;
+  if(cache){
+    fp = BaseFingerprint(name, logx + 2*logy + 4*logz);
+    fp.Add(hist);
+    fp.Add(DrawOption.at(0).draw);
+    fp.Add(Palette);
+    fp.Add(numcontours);
+    fp.Add(AutoRebin);
+    fp.Add(RebinMaxBins, sizeof(RebinMaxBins));
+    fp.Add(RebinMean);
+    if(CacheHit(name, fp)) { profile.Result("cached"); return; }
+  }
+
+  profile.Phase(kCanvasPhase);
   InitializeCanvas(logx, logy, logz); //Creating Canvas with margins
-  InitializeAxis();
-  InitializeLegend();
-  gStyle->SetNumberContours(numcontours);
+  profile.Phase(kDrawPhase);
+  TH2* drawn = RebinnedHist(logz);
+  profile.Phase(kAxisPhase);
+  InitializeAxis(drawn);
 
-  hist->Draw(Form("same,%s", ((TString) DrawOption.at(0)).Data()));
+  profile.Phase(kDrawPhase);
+  if(Raster) DrawRasterized(drawn, logx, logy, logz, numcontours);
+  else{
+    drawn->Draw(Form("same,%s", DrawOption.at(0).draw.Data()));
+    //  Set for this histogram only instead of gStyle->SetNumberContours. The hist of the caller only gets it while it is written
+    if(drawn != hist) drawn->SetContour(numcontours);
+    else Contours.push_back({drawn, numcontours});
+  }
+  profile.Count(drawn);
 
   for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){
-    funcs.at(i)->Draw(Form("same %s", ((TString) DrawOptionF.at(i)).Data()));
-    if ((Int_t)*(LegendLabelF.at(i).Data())) leg->AddEntry(funcs.at(i), LegendLabelF.at(i).Data(), (DrawOptionF.at(i).Contains("l") || DrawOptionF.at(i).Contains("hist") || DrawOptionF.at(i).Contains("C") ) ? "l" : "p");
-  } //  Dont add anything to the legend if LegendLabelF is empty
+    funcs.at(i)->Draw(Form("same %s", DrawOptionF.at(i).draw.Data()));
+    profile.Count(funcs.at(i));
+  }
 
   for( Int_t i = 0; i < (Int_t)Latex.size(); ++i) Latex.at(i)->Draw("same");
 
   for( Int_t i = 0; i < (Int_t)lines.size(); ++i) lines.at(i)->Draw("same");
+  profile.Count(Latex.size() + lines.size());
+
+  profile.Phase(kLegendPhase);
+  InitializeLegend();
+  for( Int_t i = 0; i < (Int_t)funcs.size(); ++i){
+    if ((Int_t)*(LegendLabelF.at(i).Data())) leg->AddEntry(funcs.at(i), LegendLabelF.at(i).Data(), DrawOptionF.at(i).legend);
+  } //  Dont add anything to the legend if LegendLabelF is empty
 
   leg->Draw("same");
 
-  Canvas->SaveAs(name);
-  delete Canvas;
+  //  The palette is global in ROOT and only used while painting, so Export sets it right before the file is written
+  profile.Phase(kExportPhase);
+  Export(name, Palette);
+  if(cache) CacheStore(name, fp);
+  CleanUp();
 }
 
-void Plotting2D::NewHist(TH2F* h, TString opt, Int_t palette){
+void Plotting2D::NewHist(TH2* h, TString opt, Int_t palette){
   if(!h) Abort("NewHist was given a Nullptr.");
+  if(h->GetDimension() != 2) Abort("NewHist was given a hist that is not two dimensional.");
+  SceneChanged = true;
   hist = h;
-  gStyle->SetPalette(palette);
-  DrawOption.push_back(( opt == "p") ? "p" : opt);
+  LazyObjects.clear();  //  A hist given by file and key before is replaced
+  Palette = palette;
+  DrawOption.push_back(ParseDrawOption(opt, kMapKind));
 }
 
-void Plotting2D::NewHist(TH2D* h, TString opt, Int_t palette){
-  TH2F* hd = (TH2F*)h;
-  NewHist(hd, opt,palette);
+void Plotting2D::NewHist(TString file, TString key, TString opt, Int_t palette){
+  SceneChanged = true;
+  hist = nullptr;
+  LazyObjects.clear();
+  Palette = palette;
+  DrawOption.push_back(ParseDrawOption(opt, kMapKind));
+  LazyObjects.push_back({file, key, [this, file, key](TObject *o){
+    TH2 *h = dynamic_cast<TH2*>(o);
+    if(!h || h->GetDimension() != 2) Abort(Form("%s in %s is not a 2D hist.", key.Data(), file.Data()));
+    hist = h;
+  }});
 }
 
 void Plotting2D::NewFunc(TF1* f, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!f) Abort("NewFunc was given a Nullptr.");
+  SceneChanged = true;
 
   funcs.push_back(f);
   LegendLabelF.push_back(label);
-  DrawOptionF.push_back(opt);
+  DrawOptionF.push_back(ParseDrawOption(opt, kFuncKind));
 
-  f->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
-  f->SetLineStyle(( style == -1) ? AutoStyleLine[counter] : style);
-  f->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetMarkerSize(size);
-  f->SetLineWidth(size);
+  ApplyStyle(f, counter, label, style, size, color, style);
 
   counter++;
 }
 
 void Plotting2D::InitializeCanvas(Bool_t logx, Bool_t logy, Bool_t logz){
 
-  if(Canvas) delete Canvas; //  This should never happen, but better safe than sorry.
+  if(Canvas) CleanUp(); //  This should never happen, but better safe than sorry.
 
-  Canvas = new TCanvas("Canvas", "Canvas", CanvasDimensions[0], CanvasDimensions[1]);
+  Canvas = NewCanvas(CanvasDimensions[0], CanvasDimensions[1]);
   Canvas->SetLeftMargin(CanvasMargins[0][0]);
   Canvas->SetRightMargin(1.2*CanvasMargins[0][1]);  //  To leave room for the z axis
   Canvas->SetBottomMargin(CanvasMargins[1][0]);
   Canvas->SetTopMargin(CanvasMargins[1][1]);
 
   //  Set ticks at regular intervals on every edge of the histogram (also right and top)
-  gPad->SetTickx();
-  gPad->SetTicky();
-  gStyle->SetOptStat(0);
+  Canvas->SetTickx();
+  Canvas->SetTicky();
 
   Canvas->cd();
   Canvas->SetLogx(logx);
@@ -582,26 +3995,150 @@ void Plotting2D::InitializeCanvas(Bool_t logx, Bool_t logy, Bool_t logz){
 }
 
 void Plotting2D::SetAxisLabel(TString labelx, TString labely, Double_t offsetx , Double_t offsety){
+  SceneChanged = true;
   AxisLabel[0] = labelx;
   AxisLabel[1] = labely;
   AxisLabelOffset[0] = offsetx;
   AxisLabelOffset[1] = offsety;
 }
 
-void Plotting2D::InitializeAxis(){
-  hist->GetXaxis()->SetRangeUser(AxisRange[0][0], AxisRange[0][1]);
-  hist->GetYaxis()->SetRangeUser(AxisRange[1][0], AxisRange[1][1]);
+void Plotting2D::InitializeAxis(TH2* h){
+  h->GetXaxis()->SetRangeUser(AxisRange[0][0], AxisRange[0][1]);
+  h->GetYaxis()->SetRangeUser(AxisRange[1][0], AxisRange[1][1]);
   //  Only set z axis if it has been manually changed from 0,2 (standard)
-  if( !(AxisRange[2][0] > -0.001 && AxisRange[2][0] < 0.001 && AxisRange[2][1] > 1.99 && AxisRange[2][1] < 2.001) ) hist->GetZaxis()->SetRangeUser(AxisRange[2][0], AxisRange[2][1]);
-  hist->SetStats(0);
+  if(HasZRange()) h->GetZaxis()->SetRangeUser(AxisRange[2][0], AxisRange[2][1]);
+  h->SetStats(0);
+
+  h->SetTitle("");
+  h->GetXaxis()->SetTitle(AxisLabel[0]);
+  h->GetYaxis()->SetTitle(AxisLabel[1]);
+  h->GetYaxis()->SetTitleFont(62);
+  h->GetXaxis()->SetTitleFont(62);
+  h->GetXaxis()->SetTitleOffset(AxisLabelOffset[0]);
+  h->GetYaxis()->SetTitleOffset(AxisLabelOffset[1]);
+}
+
+Bool_t Plotting2D::HasZRange(){
+  return !(AxisRange[2][0] > -0.001 && AxisRange[2][0] < 0.001 && AxisRange[2][1] > 1.99 && AxisRange[2][1] < 2.001);
+}
+
+void Plotting2D::DrawRasterized(TH2* drawn, Bool_t logx, Bool_t logy, Bool_t logz, Int_t numcontours){
+
+  //  The visible range and the z range of the hist, so the bitmap and the vector palette use the same colors
+  TAxis *xaxis = drawn->GetXaxis();
+  TAxis *yaxis = drawn->GetYaxis();
+  Double_t xlow = xaxis->GetBinLowEdge(xaxis->GetFirst());
+  Double_t xup = xaxis->GetBinUpEdge(xaxis->GetLast());
+  Double_t ylow = yaxis->GetBinLowEdge(yaxis->GetFirst());
+  Double_t yup = yaxis->GetBinUpEdge(yaxis->GetLast());
+  Double_t zmin = HasZRange() ? AxisRange[2][0] : (logz ? drawn->GetMinimum(0) : drawn->GetMinimum());
+  Double_t zmax = HasZRange() ? AxisRange[2][1] : drawn->GetMaximum();
+
+  //  An empty frame with the same axes and z range gives the axes and the palette. The bitmap covers its inside
+  TH2D *frame = Own(NewFrame("PaletteFrame", xlow, xup, ylow, yup));
+  InitializeAxis(frame);
+  frame->SetMinimum(zmin);
+  frame->SetMaximum(zmax);
+  frame->SetContour(numcontours);
+  Canvas->cd();
+  frame->Draw("COLZ");
+
+  //  The hist is painted without its own palette (Z) and gets its z range and contours back afterwards. It may be the hist of the caller,
+  //  so it is only changed while the OutputMutex is held
+  TString opt = DrawOption.at(0).draw;
+  opt.ReplaceAll("Z", "");
+  opt.ReplaceAll("z", "");
+  {
+    std::lock_guard<std::recursive_mutex> lock(OutputMutex);
+    ContourGuard contours({{drawn, numcontours}});
+    Double_t storedmin = drawn->GetMinimumStored();
+    Double_t storedmax = drawn->GetMaximumStored();
+    drawn->SetMinimum(zmin);
+    drawn->SetMaximum(zmax);
+    RasterizeFrame(xlow, xup, ylow, yup, logx, logy, logz, [&](Double_t){
+      gStyle->SetPalette(Palette); //  RasterizeFrame holds the OutputMutex
+      drawn->Draw(Form("same,%s", opt.Data()));
+    });
+    drawn->SetMinimum(storedmin);
+    drawn->SetMaximum(storedmax);
+  }
+  Canvas->RedrawAxis();
+}
+
+void Plotting2D::SetAutoRebin(Bool_t rebin, Int_t maxbinsx, Int_t maxbinsy, Bool_t mean){
+  SceneChanged = true;
+  AutoRebin = rebin;
+  RebinMaxBins[0] = maxbinsx;
+  RebinMaxBins[1] = maxbinsy;
+  RebinMean = mean;
+}
+
+TH2* Plotting2D::RebinnedHist(Bool_t logz){
+
+  if(!AutoRebin) return hist;
+
+  //  Pixels of the frame, see the margins in InitializeCanvas
+  Int_t maxbins[2] = {(Int_t)(CanvasDimensions[0]*(1 - CanvasMargins[0][0] - 1.2*CanvasMargins[0][1])), (Int_t)(CanvasDimensions[1]*(1 - CanvasMargins[1][0] - CanvasMargins[1][1]))};
+  TAxis *axis[2] = {hist->GetXaxis(), hist->GetYaxis()};
+  Int_t first[2], last[2], group[2];
+  for( Int_t k = 0; k < 2; ++k){
+    if(RebinMaxBins[k] > 0 && RebinMaxBins[k] < maxbins[k]) maxbins[k] = RebinMaxBins[k];
+    if(maxbins[k] < 1) maxbins[k] = 1;
+
+    //  Only the visible bins are copied, so the groups start at the lower edge of the range
+    first[k] = IsAutoRange(AxisRange[k][0]) ? 1 : std::max(axis[k]->FindFixBin(AxisRange[k][0]), 1);
+    last[k] = IsAutoRange(AxisRange[k][1]) ? axis[k]->GetNbins() : std::min(axis[k]->FindFixBin(AxisRange[k][1]), axis[k]->GetNbins());
+    if(last[k] > first[k] && axis[k]->GetBinLowEdge(last[k]) == AxisRange[k][1]) last[k]--;  //  The upper border is the edge of the previous bin
+    if(last[k] < first[k]) return hist;
+    group[k] = (last[k] - first[k] + maxbins[k])/maxbins[k];  //  Rounded up
+  }
+  if(group[0] == 1 && group[1] == 1) return hist;
 
-  hist->SetTitle("");
-  hist->GetXaxis()->SetTitle(AxisLabel[0]);
-  hist->GetYaxis()->SetTitle(AxisLabel[1]);
-  hist->GetYaxis()->SetTitleFont(62);
-  hist->GetXaxis()->SetTitleFont(62);
-  hist->GetXaxis()->SetTitleOffset(AxisLabelOffset[0]);
-  hist->GetYaxis()->SetTitleOffset(AxisLabelOffset[1]);
+  //  Group edges are edges of the original bins, so variable binnings are merged correctly as well
+  std::vector<Double_t> edges[2];
+  for( Int_t k = 0; k < 2; ++k){
+    for( Int_t b = first[k]; b <= last[k]; b += group[k]) edges[k].push_back(axis[k]->GetBinLowEdge(b));
+    edges[k].push_back(axis[k]->GetBinUpEdge(last[k]));
+  }
+
+  TH2D *r;
+  {
+    TDirectory::TContext NoDirectory(nullptr);
+    r = Own(new TH2D(UniqueName(Form("%s_rebinned", hist->GetName())), "", (Int_t)edges[0].size() - 1, edges[0].data(), (Int_t)edges[1].size() - 1, edges[1].data()));
+  }
+
+  //  Merge the contents as weighted sums. Summed bins have the weight 1, averaged bins 1 if they are not zero and bins of profiles their entries
+  //  (the sum of the weights they were filled with), so the merged bin is the mean of all entries. Errors use the same weights, if the hist stores them
+  TProfile2D *profile = dynamic_cast<TProfile2D*>(hist);
+  Bool_t mean = RebinMean || profile;
+  Bool_t errors = hist->GetSumw2N() > 0;
+  std::vector<Double_t> sum(r->GetNcells(), 0), err2(errors ? r->GetNcells() : 0, 0);
+  std::vector<Double_t> weights(mean ? r->GetNcells() : 0, 0);
+  for( Int_t j = first[1]; j <= last[1]; ++j){
+    Int_t jr = (j - first[1])/group[1] + 1;
+    for( Int_t i = first[0]; i <= last[0]; ++i){
+      Int_t source = hist->GetBin(i, j);
+      Double_t content = hist->GetBinContent(source);
+      Double_t w = profile ? profile->GetBinEntries(source) : (mean && content == 0 ? 0 : 1);
+      if(w == 0 || (logz && content <= 0)) continue;
+      Int_t bin = r->GetBin((i - first[0])/group[0] + 1, jr);
+      sum[bin] += w*content;
+      if(errors) { Double_t e = w*hist->GetBinError(source); err2[bin] += e*e; }
+      if(mean) weights[bin] += w;
+    }
+  }
+  for( Int_t bin = 0; bin < (Int_t)sum.size(); ++bin){
+    Double_t n = (mean && weights[bin] != 0) ? weights[bin] : 1;
+    r->SetBinContent(bin, sum[bin]/n);
+    if(errors) r->SetBinError(bin, sqrt(err2[bin])/std::abs(n));
+  }
+  r->SetEntries(hist->GetEntries());
+
+  //  Keep a z range that was set on the hist itself. Summed bins have larger contents, so then it is not meaningful and the z axis is autoset
+  if(mean && hist->GetMaximumStored() != -1111) r->SetMaximum(hist->GetMaximumStored());
+  if(mean && hist->GetMinimumStored() != -1111) r->SetMinimum(hist->GetMinimumStored());
+  r->GetZaxis()->SetTitle(hist->GetZaxis()->GetTitle());
+  return r;
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -611,19 +4148,41 @@ void Plotting2D::InitializeAxis(){
 class PlottingRatio : public Plotting{
   public:
 
+    //  How NewRatio(num, den) computes the ratio pad from two hists
+    enum RatioMode{
+      kUncorrelated,  //  num / den with independent errors
+      kBinomial,  //  num / den for an efficiency (num is a subset of den), binomial errors as TH1::Divide(.., "B")
+      kCorrelated,  //  num / den with fully correlated errors
+      kDifference,  //  num - den
+      kPull //  (num - den) / sqrt(err_num^2 + err_den^2), no errors
+    };
+
     PlottingRatio();  // This empty constructor always has to be called when plotting Ratio
 
-    ~PlottingRatio(); //  Destructor
+    ~PlottingRatio(); //  Deletes the ratios computed by NewRatio(num, den)
 
     void Plot(TString name = "dummy.pdf", Bool_t logx = false, Bool_t logy = false, Bool_t logz = false);
 
-    //  Add histograms to the upper pad
-    void NewHist(TH1F* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
-    void NewHist(TH1D* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+    //  Add histograms (any 1D type) to the upper pad
+    void NewHist(TH1* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+
+    //  Add histograms (any 1D type) to the lower pad
+    void NewRatio(TH1* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+
+    //  Same as NewHist and NewRatio with the hist key in file, read when Plot() is called (see Plotting1D::NewHist)
+    void NewHist(TString file, TString key, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+    void NewRatio(TString file, TString key, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+
+    //  Add the ratio of num and den to the lower pad. It is computed by every Plot() (so it follows refilled hists) into a hist owned by the plotting object,
+    //  no clone of the inputs is made. If one hist has coarser bins whose edges are also edges of the other one (e.g. after Rebin), the finer one is summed up to them
+    void NewRatio(TH1* num, TH1* den, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p", RatioMode mode = kUncorrelated);
 
-    //  Add histograms to the lower pad
-    void NewRatio(TH1F* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
-    void NewRatio(TH1D* h = nullptr, TString label = "", Int_t style = -1, Int_t size = 1, Int_t color = -1, TString opt = "p");
+    //  Add the band of the variations of nominal to the upper pad and the same band divided by nominal to the lower pad (see Plotting1D::NewBand).
+    //  Only the upper band gets a legend entry
+    void NewBand(TH1* nominal, std::vector<TH1*> variations, TString label = "", Int_t color = -1, BandMode mode = kEnvelope);
+
+    //  Stack the components in the upper pad (see Plotting1D::NewStack). The returned total can be the denominator of NewRatio(num, den)
+    TH1* NewStack(std::vector<TH1*> components, std::vector<TString> labels = {});
 
     //  To remove the label conflict where y and ratio axis meet, add a white box there. This function can move that box (e.g. when margins are changed) or set to red to visualize the pad.
     void SetWhite(Double_t low, Double_t left, Double_t up, Double_t right, Bool_t red = false);
@@ -653,15 +4212,15 @@ class PlottingRatio : public Plotting{
     Double_t RatioLegendBorders[2][2] = {{0.7,0.95},{0.15,0.25}};
 
     //  Vectors containing the functions for the upper pad as well as the functions and ratios for the lower pad
-    std::vector<TH1F*> ratios;
+    std::vector<TH1*> ratios;
     std::vector<TF1*> tfuncs;
     std::vector<TF1*> bfuncs;
     std::vector<TString> LegendLabelR;  //  Ratio
     std::vector<TString> LegendLabelFt; //  FunctionTop
     std::vector<TString> LegendLabelFb; //  FunctionBot
-    std::vector<TString> DrawOptionR;
-    std::vector<TString> DrawOptionFt;
-    std::vector<TString> DrawOptionFb;
+    std::vector<DrawOpt> DrawOptionR;
+    std::vector<DrawOpt> DrawOptionFt;
+    std::vector<DrawOpt> DrawOptionFb;
 
     //  The bottom pad has its own counter because it can and often should have similar colors as the top.
     //  Starts at one, because there is often no ratio to standard, so now the top histos have the same colors and styles as their bot ratios.
@@ -672,6 +4231,47 @@ class PlottingRatio : public Plotting{
 
     void InitializeAxis(Bool_t logy);
 
+    //  If the ratio range is still set to 42 use the smallest and largest ratio in the x range
+    void AutoSetRatioRange();
+
+    //  Autoset the ranges again and move the axes of the existing hDummy and rDummy to them (persistent mode)
+    void UpdateAxis(Bool_t logy);
+
+    //  DataSignature() including the ratios and the functions of both pads
+    std::vector<Double_t> RatioSignature();
+
+    //  A ratio added by NewRatio(num, den). The buffers keep their size between Plot() calls
+    struct ComputedRatio{
+      TH1 *num;
+      TH1 *den;
+      RatioMode mode;
+      TH1D *ratio; //  Owned, in ratios
+      std::vector<Double_t> edges;  //  Bin edges of ratio
+      std::vector<Int_t> numTarget; //  Bin of ratio (from 0) that each bin of num (from 0) is added to, -1 if outside
+      std::vector<Int_t> denTarget;
+      std::vector<Double_t> n, en2, d, ed2; //  Contents and squared errors of num and den summed into the bins of ratio
+      std::vector<Double_t> limits; //  BinningLimits at the last MatchBinning
+    };
+    std::vector<ComputedRatio> ComputedRatios;
+
+    //  Find the common binning of num and den and where their bins go. Aborts if num and den don't span the same range or neither bins fit into the other ones
+    void MatchBinning(ComputedRatio &c);
+
+    //  The number of bins and the axis limits of num and den, MatchBinning is repeated only when they change
+    static std::vector<Double_t> BinningLimits(const ComputedRatio &c);
+
+    //  Fill all ComputedRatios from their current inputs (called first in every Plot())
+    void ComputeRatios();
+
+    //  Plotting::Prepare with the ratios, which are computed after the stacks because they can use their totals
+    void Prepare() override;
+
+    //  Sum the contents and squared errors of the bins of h into their target bins
+    static void GatherBins(TH1* h, const std::vector<Int_t> &target, std::vector<Double_t> &content, std::vector<Double_t> &error2);
+
+    //  Per bin value and squared error of a mode, written directly into the bin and sumw2 arrays of the ratio. Branch free, so it vectorizes
+    template <Int_t Mode> static void RatioKernel(const Double_t* n, const Double_t* en2, const Double_t* d, const Double_t* ed2, Double_t* r, Double_t* er2, Int_t nbins);
+
     void InitializeLegendR(); //  Creates the legR and sets its coordinates according to RatioLegendBorders
 
 };
@@ -681,31 +4281,74 @@ PlottingRatio::PlottingRatio(){
 }
 
 PlottingRatio::~PlottingRatio(){
-
+  CleanUp();  //  The canvas may still show the computed ratios (persistent mode)
+  for( Int_t i = 0; i < (Int_t)ComputedRatios.size(); ++i) delete ComputedRatios.at(i).ratio;
 }
 
 void PlottingRatio::Plot(TString name, Bool_t logx, Bool_t logy, Bool_t logz){
 
+  Profiler profile(this, "PlottingRatio", name); //  Times the phases if profiling is enabled
+  if(!HostPad) Prepare(); //  Read the objects given by file and key, compute stacks, ratios and bands (the grid did it for its panels)
+
   if(hists.size() < 1) Abort("No hists added for plotting.");
   if(ratios.size() < 1) Abort("No ratios added for plotting.");
 
+  //  Nothing to do if the files were already written from the same input (see SetCache)
+  Bool_t cache = CacheActive();
+  Fingerprint fp;
+  if(cache){
+    fp = BaseFingerprint(name, logx + 2*logy + 4*logz);
+    for( Int_t i = 0; i < (Int_t)ratios.size(); ++i) { fp.Add(ratios.at(i)); fp.Add(DrawOptionR.at(i).draw); fp.Add(LegendLabelR.at(i)); }
+    for( Int_t i = 0; i < (Int_t)tfuncs.size(); ++i) { fp.Add(tfuncs.at(i)); fp.Add(DrawOptionFt.at(i).draw); fp.Add(LegendLabelFt.at(i)); }
+    for( Int_t i = 0; i < (Int_t)bfuncs.size(); ++i) { fp.Add(bfuncs.at(i)); fp.Add(DrawOptionFb.at(i).draw); fp.Add(LegendLabelFb.at(i)); }
+    fp.Add(WhiteBorders, sizeof(WhiteBorders));
+    fp.Add(wred);
+    fp.Add(RatioLegendBorders, sizeof(RatioLegendBorders));
+    if(CacheHit(name, fp)) { profile.Result("cached"); return; }
+  }
+
+  //  A persistent canvas that still shows the current scene only needs new axis ranges if the data changed
+  std::vector<Double_t> signature;
+  if(Persistent){
+    signature = RatioSignature();
+    //  Sampled funcs are copies and would not follow their originals (see SetFuncSampling)
+    Bool_t copiesChanged = FuncSampling && tfuncs.size() + bfuncs.size() > 0 && signature != LastSignature;
+    if(Canvas && !SceneChanged && LastLogs == logx + 2*logy + 4*logz && !copiesChanged){
+      if(signature == LastSignature && name == LastName && !BookName.Length() && !MemoryOutput) { profile.Result("unchanged"); return; } //  Exactly this plot has already been written
+      profile.Result("updated");
+      profile.Phase(kAxisPhase);
+      if(signature != LastSignature) UpdateAxis(logy);
+      profile.Phase(kExportPhase);
+      Export(name);
+      if(cache) CacheStore(name, fp);
+      KeepScene(name, logx + 2*logy + 4*logz, signature);
+      return;
+    }
+  }
+
+  profile.Phase(kCanvasPhase);
   InitializeCanvas(logx, logy, logz); //Creating Canvas with margins
+  profile.Phase(kAxisPhase);
   InitializeAxis(logy);
   hDummy->Draw();
 
-  InitializeLegend();
-  InitializeLegendR();
-
   //  Print all hists and top funcs on the HistoPad
   //----------------------------------------------------------------------------
+  profile.Phase(kDrawPhase);
   for( Int_t i = 0; i < (Int_t)hists.size(); ++i){
-    hists.at(i)->Draw(Form("same %s", ((TString) DrawOption.at(i)).Data()));
-    if ((Int_t)*(LegendLabel.at(i).Data())) leg->AddEntry(hists.at(i), LegendLabel.at(i).Data(), LegendDrawOption(DrawOption.at(i)));
+    hists.at(i)->Draw(Form("same %s", DrawOption.at(i).draw.Data()));
+    profile.Count(hists.at(i));
   }
 
   for( Int_t i = 0; i < (Int_t)tfuncs.size(); ++i){
-    tfuncs.at(i)->Draw(Form("same %s", ((TString) DrawOptionFt.at(i)).Data()));
-    if ((Int_t)*(LegendLabelFt.at(i).Data())) leg->AddEntry(tfuncs.at(i), LegendLabelFt.at(i).Data(), (DrawOptionFt.at(i).Contains("l") || DrawOptionFt.at(i).Contains("hist") || DrawOptionFt.at(i).Contains("C") ) ? "l" : "p");
+    if(FuncSampling && DrawOptionFt.at(i).straight){
+      TGraph *sampled = SampledFunc(tfuncs.at(i), HistoPad, AxisRange[1][0], AxisRange[1][1], logx, logy);
+      if(sampled->GetN() > 0) sampled->Draw("same l");
+      profile.Count(sampled);
+      continue;
+    }
+    tfuncs.at(i)->Draw(Form("same %s", DrawOptionFt.at(i).draw.Data()));
+    profile.Count(tfuncs.at(i));
   }
   //----------------------------------------------------------------------------
   //  The upper pad is now filled. Create and cd to the lower pad now
@@ -713,8 +4356,8 @@ void PlottingRatio::Plot(TString name, Bool_t logx, Bool_t logy, Bool_t logz){
   Canvas->cd();
   RatioPad->Draw();
   RatioPad->cd();
-  gPad->SetTickx();
-  gPad->SetTicky();
+  RatioPad->SetTickx();
+  RatioPad->SetTicky();
   RatioPad->SetLogx(logx);
   RatioPad->SetLogy(logz);
   rDummy->Draw();
@@ -722,17 +4365,24 @@ void PlottingRatio::Plot(TString name, Bool_t logx, Bool_t logy, Bool_t logz){
   //  Print all ratios, bot funcs and lines on the HistoPad
   //----------------------------------------------------------------------------
   for( Int_t i = 0; i < (Int_t)ratios.size(); ++i){
-    ratios.at(i)->Draw(Form("same %s", ((TString) DrawOptionR.at(i)).Data()));
-    if ((Int_t)*(LegendLabelR.at(i).Data())) legR->AddEntry(ratios.at(i), LegendLabelR.at(i).Data(), (DrawOptionR.at(i).Contains("l") || DrawOptionR.at(i).Contains("hist") ) ? "l" : "p");
+    ratios.at(i)->Draw(Form("same %s", DrawOptionR.at(i).draw.Data()));
+    profile.Count(ratios.at(i));
   }
 
   for( Int_t i = 0; i < (Int_t)bfuncs.size(); ++i){
-    bfuncs.at(i)->Draw(Form("same %s", ((TString) DrawOptionFb.at(i)).Data()));
-    if ((Int_t)*(LegendLabelFb.at(i).Data())) legR->AddEntry(bfuncs.at(i), LegendLabelFb.at(i).Data(), (DrawOptionFb.at(i).Contains("l") || DrawOptionFb.at(i).Contains("hist") || DrawOptionFb.at(i).Contains("C") ) ? "l" : "p");
+    if(FuncSampling && DrawOptionFb.at(i).straight){
+      TGraph *sampled = SampledFunc(bfuncs.at(i), RatioPad, AxisRange[2][0], AxisRange[2][1], logx, logz);
+      if(sampled->GetN() > 0) sampled->Draw("same l");
+      profile.Count(sampled);
+      continue;
+    }
+    bfuncs.at(i)->Draw(Form("same %s", DrawOptionFb.at(i).draw.Data()));
+    profile.Count(bfuncs.at(i));
   }
 
   //  Lines are always drawn on the ratio pad, because they are almost exclusively needed there (e.g. line marking ratio 1)
   for( Int_t i = 0; i < (Int_t)lines.size(); ++i) lines.at(i)->Draw("same");
+  profile.Count(lines.size() + Latex.size());
   //----------------------------------------------------------------------------
   //  Both pads are now filled. Create the white rectangle hiding the axis label conflict now
 
@@ -743,84 +4393,289 @@ void PlottingRatio::Plot(TString name, Bool_t logx, Bool_t logy, Bool_t logz){
   Canvas->cd(); //  cd back to canvas in order to draw legend and Latex over entire canvas in relative coordinates
   Canvas->Update();
 
+  //  The legends of both pads get their entries only now that everything is drawn
+  profile.Phase(kLegendPhase);
+  InitializeLegend();
+  InitializeLegendR();
+
+  for( Int_t i = 0; i < (Int_t)hists.size(); ++i){
+    if ((Int_t)*(LegendLabel.at(i).Data())) leg->AddEntry(hists.at(i), LegendLabel.at(i).Data(), DrawOption.at(i).legend);
+  }
+
+  for( Int_t i = 0; i < (Int_t)tfuncs.size(); ++i){
+    if ((Int_t)*(LegendLabelFt.at(i).Data())) leg->AddEntry(tfuncs.at(i), LegendLabelFt.at(i).Data(), DrawOptionFt.at(i).legend);
+  }
+
+  for( Int_t i = 0; i < (Int_t)ratios.size(); ++i){
+    if ((Int_t)*(LegendLabelR.at(i).Data())) legR->AddEntry(ratios.at(i), LegendLabelR.at(i).Data(), DrawOptionR.at(i).legend);
+  }
+
+  for( Int_t i = 0; i < (Int_t)bfuncs.size(); ++i){
+    if ((Int_t)*(LegendLabelFb.at(i).Data())) legR->AddEntry(bfuncs.at(i), LegendLabelFb.at(i).Data(), DrawOptionFb.at(i).legend);
+  }
+
   leg->Draw("same");
   legR->Draw("same");
 
+  profile.Phase(kDrawPhase);
   for(  Int_t i = 0; i < (Int_t)Latex.size(); ++i) Latex.at(i)->Draw("same");
 
-  Canvas->SaveAs(name);
-  delete hDummy;
-  delete rDummy;
-  delete Canvas;
+  profile.Phase(kExportPhase);
+  Export(name);
+  if(cache) CacheStore(name, fp);
+  if(Persistent){
+    KeepScene(name, logx + 2*logy + 4*logz, signature);
+    return;
+  }
+  CleanUp();
+  rDummy = nullptr;
+  legR = nullptr;
+  HistoPad = RatioPad = WhitePad = nullptr;
 }
 
-void PlottingRatio::NewHist(TH1F* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+void PlottingRatio::NewHist(TH1* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!h) Abort("NewHist was given a Nullptr.");
+  if(h->GetDimension() != 1) Abort("NewHist was given a hist with more than one dimension.");
+  SceneChanged = true;
 
   hists.push_back(h);
   LegendLabel.push_back(label);
-  //  Lines and curves are only drawn as such when you add "hist" to the DrawOption
-  DrawOption.push_back( (opt == "l" || opt == "c") ? opt+" hist" : opt );
+  DrawOption.push_back(ParseDrawOption(opt, kHistKind));
   h->SetStats(0);
 
-  h->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
   //  LineStyles > 10 make root crash. If its not drawn in hist style, the errors are the only lines and should be style 1
-  h->SetLineStyle( (opt.Contains("h") && style < 10) ? style : 1 );
-  h->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  h->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  h->SetMarkerSize(size);
-  h->SetLineWidth(size);
+  ApplyStyle(h, counter, label, style, size, color, (DrawOption.back().line && style < 10 && style != -1) ? style : 1);
 
   if((style == -1) && (color == -1) ) counter++;  //  Only count up, when Auto has been used -> Don't skip all the good colors
 }
 
-void PlottingRatio::NewHist(TH1D* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
-  TH1F* hd = (TH1F*)h;
-  NewHist(hd, label, style, size, color, opt);
-}
-
-void PlottingRatio::NewRatio(TH1F* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+void PlottingRatio::NewRatio(TH1* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
-  if(!h) Abort("NewHist was given a Nullptr.");
+  if(!h) Abort("NewRatio was given a Nullptr.");
+  if(h->GetDimension() != 1) Abort("NewRatio was given a hist with more than one dimension.");
+  SceneChanged = true;
 
   ratios.push_back(h);
   LegendLabelR.push_back(label);
-  //  Lines and curves are only drawn as such when you add "hist" to the DrawOption
-  DrawOptionR.push_back( (opt == "l" || opt == "c") ? opt+" hist" : opt );
+  DrawOptionR.push_back(ParseDrawOption(opt, kRatioKind));
 
   h->SetStats(0);
-  h->SetMarkerStyle(( style == -1) ? AutoStyle[counterR] : style);
   //  LineStyles > 10 make root crash. If its not drawn in hist style, the errors are the only lines and should be style 1
-  h->SetLineStyle( (opt.Contains("h") && style < 10) ? style : 1 );
-  h->SetMarkerColor(( color == -1) ? AutoColor[counterR] : color);
-  h->SetLineColor(( color == -1) ? AutoColor[counterR] : color);
-  h->SetMarkerSize(size);
-  h->SetLineWidth(size);
+  ApplyStyle(h, counterR, label, style, size, color, (DrawOptionR.back().line && style < 10 && style != -1) ? style : 1);
+
+  if((style == -1) && (color == -1) ) counterR++;
+}
+
+void PlottingRatio::NewHist(TString file, TString key, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+  SceneChanged = true;
+
+  LegendLabel.push_back(label);
+  DrawOption.push_back(ParseDrawOption(opt, kHistKind));
+  NewLazy(file, key, hists, DrawOption, counter, label, style, size, color);
+
+  if((style == -1) && (color == -1) ) counter++;
+}
+
+void PlottingRatio::NewRatio(TString file, TString key, TString label, Int_t style, Int_t size, Int_t color, TString opt){
+  SceneChanged = true;
+
+  LegendLabelR.push_back(label);
+  DrawOptionR.push_back(ParseDrawOption(opt, kRatioKind));
+  NewLazy(file, key, ratios, DrawOptionR, counterR, label, style, size, color);
 
   if((style == -1) && (color == -1) ) counterR++;
 }
 
-void PlottingRatio::NewRatio(TH1D* h, TString label, Int_t style, Int_t size, Int_t color, TString opt){
-  TH1F* hd = (TH1F*)h;
-  NewRatio(hd, label, style, size, color, opt);
+void PlottingRatio::NewRatio(TH1* num, TH1* den, TString label, Int_t style, Int_t size, Int_t color, TString opt, RatioMode mode){
+
+  if(!num || !den) Abort("NewRatio was given a Nullptr.");
+  if(num->GetDimension() != 1 || den->GetDimension() != 1) Abort("NewRatio was given a hist with more than one dimension.");
+
+  ComputedRatio c;
+  c.num = num;
+  c.den = den;
+  c.mode = mode;
+  MatchBinning(c);
+  {
+    TDirectory::TContext NoDirectory(nullptr);
+    c.ratio = new TH1D(UniqueName("Ratio"), "", c.edges.size() - 1, c.edges.data());
+  }
+  c.ratio->Sumw2();
+  ComputedRatios.push_back(c);
+
+  NewRatio(c.ratio, label, style, size, color, opt);
+}
+
+void PlottingRatio::NewBand(TH1* nominal, std::vector<TH1*> variations, TString label, Int_t color, BandMode mode){
+  ComputedBands.push_back(NewComputedBand(nominal, variations, mode, true));
+  ComputedBand &b = ComputedBands.back();
+  NewHist(b.band, label, -1, 1, color, "E2");
+  StyleBand(b.band);
+  DrawOption.back().legend = "f";
+  NewRatio(b.ratio, "", -1, 1, b.band->GetLineColor(), "E2");  //  An explicit color does not use up a theme entry of the ratios
+  StyleBand(b.ratio);
+}
+
+TH1* PlottingRatio::NewStack(std::vector<TH1*> components, std::vector<TString> labels){
+  ComputedStacks.push_back(NewComputedStack(components));
+  ComputedStack &stack = ComputedStacks.back();
+  ComputeStack(stack);  //  NewRatio(num, den) needs the binning of the total right away
+
+  Int_t first = counter;
+  for( Int_t i = (Int_t)stack.layers.size() - 1; i >= 0; --i){
+    counter = first + i;
+    NewHist(stack.layers.at(i), i < (Int_t)labels.size() ? labels.at(i) : "", -1, 1, -1, "hist");
+    StyleLayer(stack.layers.at(i));
+    DrawOption.back().legend = "f";
+  }
+  counter = first + stack.layers.size();
+  return stack.layers.back();
+}
+
+void PlottingRatio::MatchBinning(ComputedRatio &c){
+  std::vector<Double_t> numEdges, denEdges;
+  for( Int_t i = 1; i <= c.num->GetNbinsX() + 1; ++i) numEdges.push_back(c.num->GetBinLowEdge(i));
+  for( Int_t i = 1; i <= c.den->GetNbinsX() + 1; ++i) denEdges.push_back(c.den->GetBinLowEdge(i));
+
+  const std::vector<Double_t> &coarse = numEdges.size() <= denEdges.size() ? numEdges : denEdges;
+  const std::vector<Double_t> &fine = numEdges.size() <= denEdges.size() ? denEdges : numEdges;
+  Double_t tolerance = 1e-9 * (fine.back() - fine.front());
+  if(TMath::Abs(numEdges.front() - denEdges.front()) > tolerance || TMath::Abs(numEdges.back() - denEdges.back()) > tolerance)
+    Abort(Form("NewRatio was given %s and %s, which don't span the same range.", c.num->GetName(), c.den->GetName()));
+
+  //  Every edge of the coarser binning has to be an edge of the finer one
+  for( Int_t i = 0; i < (Int_t)coarse.size(); ++i){
+    auto next = std::lower_bound(fine.begin(), fine.end(), coarse.at(i) - tolerance);
+    if(next == fine.end() || TMath::Abs(*next - coarse.at(i)) > tolerance)
+      Abort(Form("NewRatio was given %s and %s, whose bins don't fit into each other.", c.num->GetName(), c.den->GetName()));
+  }
+  c.edges = coarse;
+
+  //  A bin goes to the coarse bin that contains its center
+  auto targets = [&](const std::vector<Double_t> &from, std::vector<Int_t> &target){
+    target.resize(from.size() - 1);
+    for( Int_t i = 0; i < (Int_t)target.size(); ++i){
+      Double_t center = 0.5 * (from.at(i) + from.at(i+1));
+      Int_t bin = std::upper_bound(coarse.begin(), coarse.end(), center) - coarse.begin() - 1;
+      target.at(i) = (bin >= 0 && bin < (Int_t)coarse.size() - 1) ? bin : -1;
+    }
+  };
+  targets(numEdges, c.numTarget);
+  targets(denEdges, c.denTarget);
+  c.limits = BinningLimits(c);
+}
+
+std::vector<Double_t> PlottingRatio::BinningLimits(const ComputedRatio &c){
+  return {(Double_t)c.num->GetNbinsX(), c.num->GetXaxis()->GetXmin(), c.num->GetXaxis()->GetXmax(),
+          (Double_t)c.den->GetNbinsX(), c.den->GetXaxis()->GetXmin(), c.den->GetXaxis()->GetXmax()};
+}
+
+void PlottingRatio::GatherBins(TH1* h, const std::vector<Int_t> &target, std::vector<Double_t> &content, std::vector<Double_t> &error2){
+  std::fill(content.begin(), content.end(), 0.);
+  std::fill(error2.begin(), error2.end(), 0.);
+  const Int_t nbins = target.size();
+  const Double_t *sumw2 = h->GetSumw2N() ? h->GetSumw2()->GetArray() : nullptr;
+
+  //  Without sumw2 the errors are sqrt(content), as in TH1::GetBinError. Index 0 of the arrays is the underflow
+  Bool_t direct = VisitBinArray(h, [&](const auto* c){
+    for( Int_t i = 0; i < nbins; ++i){
+      const Int_t t = target[i];
+      if(t < 0) continue;
+      content[t] += c[i+1];
+      error2[t] += sumw2 ? sumw2[i+1] : TMath::Abs((Double_t)c[i+1]);
+    }
+  });
+  if(direct) return;
+
+  for( Int_t i = 0; i < nbins; ++i){  //  Profiles calculate their contents and errors
+    const Int_t t = target[i];
+    if(t < 0) continue;
+    content[t] += h->GetBinContent(i+1);
+    error2[t] += h->GetBinError(i+1) * h->GetBinError(i+1);
+  }
+}
+
+template <Int_t Mode> void PlottingRatio::RatioKernel(const Double_t* n, const Double_t* en2, const Double_t* d, const Double_t* ed2, Double_t* r, Double_t* er2, Int_t nbins){
+  for( Int_t i = 0; i < nbins; ++i){
+    const Double_t invd = d[i] != 0 ? 1. / d[i] : 0.;  //  Empty denominator bins give 0 +- 0
+    const Double_t q = n[i] * invd;
+    if(Mode == kUncorrelated){
+      r[i] = q;
+      er2[i] = (en2[i] + q * q * ed2[i]) * invd * invd;
+    }
+    if(Mode == kBinomial){
+      r[i] = q;
+      er2[i] = TMath::Abs((1. - 2. * q) * en2[i] + q * q * ed2[i]) * invd * invd;
+    }
+    if(Mode == kCorrelated){
+      const Double_t e = (std::sqrt(en2[i]) - q * std::sqrt(ed2[i])) * invd;
+      r[i] = q;
+      er2[i] = e * e;
+    }
+    if(Mode == kDifference){
+      r[i] = n[i] - d[i];
+      er2[i] = en2[i] + ed2[i];
+    }
+    if(Mode == kPull){
+      const Double_t sigma2 = en2[i] + ed2[i];
+      const Double_t invsigma = sigma2 > 0 ? 1. / std::sqrt(sigma2) : 0.;
+      r[i] = (n[i] - d[i]) * invsigma;
+      er2[i] = 0;
+    }
+  }
+}
+
+void PlottingRatio::Prepare(){
+  ResolveLazy(); //  Read the objects given by file and key
+  ComputeStacks();  //  From the current contents of their inputs, first because the ratios and bands can use their totals
+  ComputeRatios();
+  ComputeBands();
 }
 
+void PlottingRatio::ComputeRatios(){
+  for( Int_t i = 0; i < (Int_t)ComputedRatios.size(); ++i){
+    ComputedRatio &c = ComputedRatios.at(i);
+
+    //  The inputs can have been rebinned since the last Plot()
+    if(BinningLimits(c) != c.limits){
+      std::vector<Double_t> edges = c.edges;
+      MatchBinning(c);
+      if(edges != c.edges){
+        c.ratio->SetBins(c.edges.size() - 1, c.edges.data());
+        c.ratio->Sumw2(kFALSE);
+        c.ratio->Sumw2();
+      }
+    }
+
+    const Int_t nbins = c.edges.size() - 1;
+    c.n.resize(nbins);
+    c.en2.resize(nbins);
+    c.d.resize(nbins);
+    c.ed2.resize(nbins);
+    GatherBins(c.num, c.numTarget, c.n, c.en2);
+    GatherBins(c.den, c.denTarget, c.d, c.ed2);
+
+    Double_t *r = c.ratio->GetArray() + 1;  //  Skip the underflow
+    Double_t *er2 = c.ratio->GetSumw2()->GetArray() + 1;
+    if(c.mode == kUncorrelated) RatioKernel<kUncorrelated>(c.n.data(), c.en2.data(), c.d.data(), c.ed2.data(), r, er2, nbins);
+    else if(c.mode == kBinomial) RatioKernel<kBinomial>(c.n.data(), c.en2.data(), c.d.data(), c.ed2.data(), r, er2, nbins);
+    else if(c.mode == kCorrelated) RatioKernel<kCorrelated>(c.n.data(), c.en2.data(), c.d.data(), c.ed2.data(), r, er2, nbins);
+    else if(c.mode == kDifference) RatioKernel<kDifference>(c.n.data(), c.en2.data(), c.d.data(), c.ed2.data(), r, er2, nbins);
+    else RatioKernel<kPull>(c.n.data(), c.en2.data(), c.d.data(), c.ed2.data(), r, er2, nbins);
+  }
+}
 
 void PlottingRatio::NewTopFunc(TF1* f, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!f) Abort("NewTopFunc was given a Nullptr.");
+  SceneChanged = true;
 
   tfuncs.push_back(f);
   LegendLabelFt.push_back(label);
-  DrawOptionFt.push_back(opt);
+  DrawOptionFt.push_back(ParseDrawOption(opt, kFuncKind));
 
-  f->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
-  f->SetLineStyle(( style == -1) ? AutoStyleLine[counter] : style);
-  f->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetMarkerSize(size);
-  f->SetLineWidth(size);
+  ApplyStyle(f, counter, label, style, size, color, style);
 
   counter++;
 }
@@ -828,22 +4683,19 @@ void PlottingRatio::NewTopFunc(TF1* f, TString label, Int_t style, Int_t size, I
 void PlottingRatio::NewBotFunc(TF1* f, TString label, Int_t style, Int_t size, Int_t color, TString opt){
 
   if(!f) Abort("NewBotFunc was given a Nullptr.");
+  SceneChanged = true;
 
   bfuncs.push_back(f);
   LegendLabelFb.push_back(label);
-  DrawOptionFb.push_back(opt);
+  DrawOptionFb.push_back(ParseDrawOption(opt, kFuncKind));
 
-  f->SetMarkerStyle(( style == -1) ? AutoStyle[counter] : style);
-  f->SetLineStyle(( style == -1) ? AutoStyleLine[counter] : style);
-  f->SetMarkerColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetLineColor(( color == -1) ? AutoColor[counter] : color);
-  f->SetMarkerSize(size);
-  f->SetLineWidth(size);
+  ApplyStyle(f, counter, label, style, size, color, style);
 
   counter++;
 }
 
 void PlottingRatio::SetAxisLabel(TString labelx, TString labely, TString labelz, Double_t offsetx , Double_t offsety){
+  SceneChanged = true;
   AxisLabel[0] = labelx;
   AxisLabel[1] = labely;
   AxisLabel[2] = labelz;
@@ -853,34 +4705,13 @@ void PlottingRatio::SetAxisLabel(TString labelx, TString labely, TString labelz,
 
 void PlottingRatio::InitializeAxis(Bool_t logy){
 
-  if(hDummy) delete hDummy;
-
   AutoSetAxisRanges(logy);
 
-  hDummy = new TH2D("hDummy", "hDummy", 1000, AxisRange[0][0], AxisRange[0][1], 1000, AxisRange[1][0], AxisRange[1][1]);
-  hDummy->SetTitle("");
-  hDummy->SetStats(0);
-
-  if(rDummy) delete rDummy; //  This should never happen, but better safe than sorry.
-
-  Double_t max = ratios.at(0)->GetMaximum();
-  Double_t min = 0; //  Ratios can often start at 0.
-  //  Find the smalles and largest bin in all loaded ratios
-  for ( Int_t i = 0; i < (Int_t)ratios.size(); i++) {
-    max = ratios.at(i)->GetMaximum() > max ? ratios.at(i)->GetMaximum() : max;
-    min = ratios.at(i)->GetMinimum() < min ? ratios.at(i)->GetMinimum() : min;
-  }
-
-  //  Leave room between the highest bin and the upper pad
-  max = max+(max-min)/10;
+  hDummy = Own(NewFrame("hDummy", AxisRange[0][0], AxisRange[0][1], AxisRange[1][0], AxisRange[1][1]));
 
-  //  If the respective range was set to 42 use the just calculated estimates
-  if (AxisRange[2][0] > 41.99 && AxisRange[2][0] < 42.01) AxisRange[2][0] = min;
-  if (AxisRange[2][1] > 41.99 && AxisRange[2][1] < 42.01) AxisRange[2][1] = max;
+  AutoSetRatioRange();
 
-  rDummy = new TH2D("rDummy", "rDummy", 1000, AxisRange[0][0], AxisRange[0][1], 1000, AxisRange[2][0], AxisRange[2][1]);
-  rDummy->SetTitle("");
-  rDummy->SetStats(0);
+  rDummy = Own(NewFrame("rDummy", AxisRange[0][0], AxisRange[0][1], AxisRange[2][0], AxisRange[2][1]));
 
   Double_t labelandtitlesize = 0.04;  //  Labels and titles can use the same size
   hDummy->GetYaxis()->SetLabelSize(labelandtitlesize);
@@ -906,7 +4737,50 @@ void PlottingRatio::InitializeAxis(Bool_t logy){
   rDummy->GetXaxis()->SetTitleOffset(AxisLabelOffset[0]);
 }
 
+void PlottingRatio::AutoSetRatioRange(){
+
+  //  Find the smalles and largest bin in all loaded ratios in the visible x window
+  Extrema ratioExtrema;
+  for ( Int_t i = 0; i < (Int_t)ratios.size(); i++) ratioExtrema.Merge(ScanHist(ratios.at(i), AxisRange[0][0], AxisRange[0][1]));
+  Double_t max = std::isinf(ratioExtrema.max) ? 2 : ratioExtrema.max;
+  Double_t min = ratioExtrema.min < 0 ? ratioExtrema.min : 0; //  Ratios can often start at 0.
+
+  //  Leave room between the highest bin and the upper pad
+  max = max+(max-min)/10;
+
+  //  If the respective range was set to 42 use the just calculated estimates
+  if (AxisRange[2][0] > 41.99 && AxisRange[2][0] < 42.01) AxisRange[2][0] = min;
+  if (AxisRange[2][1] > 41.99 && AxisRange[2][1] < 42.01) AxisRange[2][1] = max;
+}
+
+void PlottingRatio::UpdateAxis(Bool_t logy){
+  ResetAxisRange();
+  AutoSetAxisRanges(logy);
+  AutoSetRatioRange();
+  hDummy->GetXaxis()->SetLimits(AxisRange[0][0], AxisRange[0][1]);
+  hDummy->GetYaxis()->SetLimits(AxisRange[1][0], AxisRange[1][1]);
+  rDummy->GetXaxis()->SetLimits(AxisRange[0][0], AxisRange[0][1]);
+  rDummy->GetYaxis()->SetLimits(AxisRange[2][0], AxisRange[2][1]);
+  HistoPad->Modified();
+  RatioPad->Modified();
+  Canvas->Modified();
+  Canvas->Update();
+}
+
+std::vector<Double_t> PlottingRatio::RatioSignature(){
+  std::vector<Double_t> signature = DataSignature();
+  for( Int_t i = 0; i < (Int_t)ratios.size(); ++i) AppendSignature(signature, ratios.at(i));
+  for( Int_t i = 0; i < (Int_t)ComputedRatios.size(); ++i){
+    AppendSignature(signature, ComputedRatios.at(i).num);
+    AppendSignature(signature, ComputedRatios.at(i).den);
+  } //  A denominator that is not drawn itself would otherwise be missed
+  for( Int_t i = 0; i < (Int_t)tfuncs.size(); ++i) AppendSignature(signature, tfuncs.at(i));
+  for( Int_t i = 0; i < (Int_t)bfuncs.size(); ++i) AppendSignature(signature, bfuncs.at(i));
+  return signature;
+}
+
 void PlottingRatio::SetWhite(Double_t low, Double_t left, Double_t up, Double_t right, Bool_t red){
+  SceneChanged = true;
   WhiteBorders[0][0] = left;
   WhiteBorders[0][1] = right;
   WhiteBorders[1][0] = low;
@@ -916,13 +4790,13 @@ void PlottingRatio::SetWhite(Double_t low, Double_t left, Double_t up, Double_t
 
 void PlottingRatio::InitializeCanvas(Bool_t logx, Bool_t logy, Bool_t logz){
 
-  if(Canvas) delete Canvas; //  This should never happen, but better safe than sorry.
+  if(Canvas) CleanUp(); //  This should never happen, but better safe than sorry.
 
-  Canvas = new TCanvas("Canvas", "Canvas", 1000, 1000);
+  Canvas = NewCanvas(1000, 1000);
 
-  HistoPad = new TPad("HistoPad", "HistoPad", 0.0, 1.0/3.0, 1, 1);
-  RatioPad = new TPad("RatioPad", "RatioPad", 0.0, 0.0, 1, 1.0/3.0);
-  WhitePad = new TPad("WhitePad", "WhitePad", WhiteBorders[0][0], WhiteBorders[1][0], WhiteBorders[0][1], WhiteBorders[1][1]);
+  HistoPad = Own(new TPad(UniqueName("HistoPad"), "HistoPad", 0.0, 1.0/3.0, 1, 1));
+  RatioPad = Own(new TPad(UniqueName("RatioPad"), "RatioPad", 0.0, 0.0, 1, 1.0/3.0));
+  WhitePad = Own(new TPad(UniqueName("WhitePad"), "WhitePad", WhiteBorders[0][0], WhiteBorders[1][0], WhiteBorders[0][1], WhiteBorders[1][1]));
 
   HistoPad->SetTopMargin(CanvasMargins[1][1]);
   HistoPad->SetRightMargin(CanvasMargins[0][1]);
@@ -937,14 +4811,15 @@ void PlottingRatio::InitializeCanvas(Bool_t logx, Bool_t logy, Bool_t logz){
   HistoPad->Draw();
   HistoPad->cd();
 
-  gPad->SetTickx();
-  gPad->SetTicky();
+  HistoPad->SetTickx();
+  HistoPad->SetTicky();
 
   HistoPad->SetLogy(logy);
   HistoPad->SetLogx(logx);
 }
 
 void PlottingRatio::SetLegendR(Double_t x1, Double_t x2, Double_t y1, Double_t y2){
+  SceneChanged = true;
   RatioLegendBorders[0][0] = x1;
   RatioLegendBorders[0][1] = x2;
   RatioLegendBorders[1][0] = y1;
@@ -953,7 +4828,7 @@ void PlottingRatio::SetLegendR(Double_t x1, Double_t x2, Double_t y1, Double_t y
 
 
 void PlottingRatio::InitializeLegendR(){
-  legR = new TLegend(RatioLegendBorders[0][0], RatioLegendBorders[1][0], RatioLegendBorders[0][1], RatioLegendBorders[1][1]);
+  legR = Own(new TLegend(RatioLegendBorders[0][0], RatioLegendBorders[1][0], RatioLegendBorders[0][1], RatioLegendBorders[1][1]));
   legR->SetHeader("");
   legR->SetTextFont(42);
   legR->SetTextSize(0.6*0.035);
@@ -969,6 +4844,8 @@ class PlottingPaint : public Plotting{
 
   public:
 
+    ~PlottingPaint(); //  Deletes the angles
+
     //  Using this class one can draw ellipses, angles, lines and curly lines
     void Plot(TString name = "You_forgot_the_name_..._dummy.pdf");
 
@@ -986,10 +4863,18 @@ class PlottingPaint : public Plotting{
 
 };
 
+PlottingPaint::~PlottingPaint(){
+  for( Int_t i = 0; i < (Int_t)angles.size(); ++i) delete angles.at(i);
+}
+
 void PlottingPaint::Plot(TString name){
 
+  Profiler profile(this, "PlottingPaint", name); //  Times the phases if profiling is enabled
+
+  profile.Phase(kCanvasPhase);
   InitializeCanvas(); //  Creating Canvas with margins
 
+  profile.Phase(kDrawPhase);
   for( Int_t i = 0; i < (Int_t)angles.size(); ++i) angles.at(i)->Draw("same");
 
   for( Int_t i = 0; i < (Int_t)lines.size(); ++i) lines.at(i)->Draw("same");
@@ -997,12 +4882,15 @@ void PlottingPaint::Plot(TString name){
   for( Int_t i = 0; i < (Int_t)clines.size(); ++i) clines.at(i)->Draw("same");
 
   for( Int_t i = 0; i < (Int_t)Latex.size(); ++i) Latex.at(i)->Draw("same");
+  profile.Count(angles.size() + lines.size() + clines.size() + Latex.size());
 
-  Canvas->SaveAs(name);
-  delete Canvas;
+  profile.Phase(kExportPhase);
+  Export(name);
+  CleanUp();
 }
 
 void PlottingPaint::NewAngle(Double_t x, Double_t y, Double_t r1, Double_t r2, Double_t phimin, Double_t phimax , Double_t theta){
+  SceneChanged = true;
 
   TEllipse* angle = new TEllipse(x,y,r1,r2,phimin,phimax,theta);
   angle->SetNoEdges();
@@ -1011,10 +4899,252 @@ void PlottingPaint::NewAngle(Double_t x, Double_t y, Double_t r1, Double_t r2, D
 
 void PlottingPaint::InitializeCanvas(){
 
-  if(Canvas) delete Canvas; //  This should never happen, but better safe than sorry.
+  if(Canvas) CleanUp(); //  This should never happen, but better safe than sorry.
 
-  Canvas = new TCanvas("Canvas", "Canvas", CanvasDimensions[0], CanvasDimensions[1]);
+  Canvas = NewCanvas(CanvasDimensions[0], CanvasDimensions[1]);
   Canvas->cd();
 }
 
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//+++++++++++++++++++++++++++++++ Plotting Grid ++++++++++++++++++++++++++++++++
+//++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+//  Summary pages: columns x rows independent plots on one canvas, written once
+
+class PlottingGrid : public Plotting{
+  public:
+
+    //  columns x rows panels on a canvas of cw x ch pixels
+    PlottingGrid(Int_t columns = 2, Int_t rows = 2, Int_t cw = 2400, Int_t ch = 2000);
+
+    ~PlottingGrid();
+
+    //  Create the panel in column and row (from 0, starting top left) and return it. It is set up like any plotting object (New.., Set.., DrawLatex).
+    //  Its margins are used inside its pad, the logs and contours are given to its Plot() by the Plot() of the grid
+    Plotting1D& Panel1D(Int_t column, Int_t row, Bool_t logx = false, Bool_t logy = false);
+    Plotting2D& Panel2D(Int_t column, Int_t row, Bool_t logx = false, Bool_t logy = false, Bool_t logz = false, Int_t numcontours = 100);
+    PlottingRatio& PanelRatio(Int_t column, Int_t row, Bool_t logx = false, Bool_t logy = false, Bool_t logz = false);
+
+    //  The Plotting1D and PlottingRatio panels of a column get the same x range and the ones of a row the same y range (the union of their autoset
+    //  ranges, borders set with SetAxisRange are kept). The axis titles are then only drawn in the bottom row and the left column
+    void SetSharedAxes(Bool_t sharex = true, Bool_t sharey = true);
+
+    //  Draw every panel into its pad and write the canvas once in all Formats (and as one page of an open book). DrawLatex of the grid writes over the whole canvas.
+    //  The palette is global in ROOT, so all Plotting2D panels are painted with the palette of the last one
+    void Plot(TString name = "dummy.pdf");
+
+  private:
+
+    Int_t Columns;
+    Int_t Rows;
+    Bool_t ShareX = false;
+    Bool_t ShareY = false;
+
+    struct Panel{
+      Int_t type; //  1: Plotting1D, 2: Plotting2D, 3: PlottingRatio
+      Int_t index;  //  In Panels1D, Panels2D or PanelsRatio
+      Int_t column;
+      Int_t row;
+      Bool_t logs[3] = {false, false, false};
+      Int_t numcontours = 100;
+      Double_t UserRange[2][2]; //  Range and titles of the panel, restored after SetSharedAxes changed them
+      TString Label[2];
+    };
+    std::vector<Panel> Panels;
+    std::vector<std::unique_ptr<Plotting1D>> Panels1D;
+    std::vector<std::unique_ptr<Plotting2D>> Panels2D;
+    std::vector<std::unique_ptr<PlottingRatio>> PanelsRatio;
+
+    //  The panel as a Plotting (its ranges, titles and host pad)
+    Plotting* Base(const Panel &p);
+
+    //  Checks the cell and adds the panel
+    void AddPanel(Int_t type, Int_t index, Int_t column, Int_t row, Bool_t logx, Bool_t logy, Bool_t logz);
+
+    //  Autoset the ranges of all 1D and Ratio panels and give each of them the union of its column (x) and row (y). Only their inner axis titles are removed
+    void ShareAxes();
+
+    //  Give every panel its own ranges and titles back and let it delete what it drew
+    void ReleasePanels();
+
+};
+
+PlottingGrid::PlottingGrid(Int_t columns, Int_t rows, Int_t cw, Int_t ch){
+  if(columns < 1 || rows < 1) Abort("PlottingGrid needs at least one column and one row.");
+  Columns = columns;
+  Rows = rows;
+  CanvasDimensions[0] = cw;
+  CanvasDimensions[1] = ch;
+}
+
+PlottingGrid::~PlottingGrid(){
+
+}
+
+Plotting* PlottingGrid::Base(const Panel &p){
+  if(p.type == 1) return Panels1D.at(p.index).get();
+  if(p.type == 2) return Panels2D.at(p.index).get();
+  return PanelsRatio.at(p.index).get();
+}
+
+void PlottingGrid::AddPanel(Int_t type, Int_t index, Int_t column, Int_t row, Bool_t logx, Bool_t logy, Bool_t logz){
+  if(column < 0 || column >= Columns || row < 0 || row >= Rows) Abort(Form("PlottingGrid has no panel %d,%d.", column, row));
+  for( Int_t i = 0; i < (Int_t)Panels.size(); ++i){
+    if(Panels.at(i).column == column && Panels.at(i).row == row) Abort(Form("Panel %d,%d of PlottingGrid was added twice.", column, row));
+  }
+  SceneChanged = true;
+  Panel p;
+  p.type = type;
+  p.index = index;
+  p.column = column;
+  p.row = row;
+  p.logs[0] = logx;
+  p.logs[1] = logy;
+  p.logs[2] = logz;
+  Panels.push_back(p);
+}
+
+Plotting1D& PlottingGrid::Panel1D(Int_t column, Int_t row, Bool_t logx, Bool_t logy){
+  AddPanel(1, Panels1D.size(), column, row, logx, logy, false);
+  Panels1D.emplace_back(new Plotting1D());
+  return *Panels1D.back();
+}
+
+Plotting2D& PlottingGrid::Panel2D(Int_t column, Int_t row, Bool_t logx, Bool_t logy, Bool_t logz, Int_t numcontours){
+  AddPanel(2, Panels2D.size(), column, row, logx, logy, logz);
+  Panels.back().numcontours = numcontours;
+  Panels2D.emplace_back(new Plotting2D());
+  return *Panels2D.back();
+}
+
+PlottingRatio& PlottingGrid::PanelRatio(Int_t column, Int_t row, Bool_t logx, Bool_t logy, Bool_t logz){
+  AddPanel(3, PanelsRatio.size(), column, row, logx, logy, logz);
+  PanelsRatio.emplace_back(new PlottingRatio());
+  return *PanelsRatio.back();
+}
+
+void PlottingGrid::SetSharedAxes(Bool_t sharex, Bool_t sharey){
+  SceneChanged = true;
+  ShareX = sharex;
+  ShareY = sharey;
+}
+
+void PlottingGrid::ShareAxes(){
+  std::vector<Double_t> xlow(Columns, std::numeric_limits<Double_t>::infinity()), xup(Columns, -std::numeric_limits<Double_t>::infinity());
+  std::vector<Double_t> ylow(Rows, std::numeric_limits<Double_t>::infinity()), yup(Rows, -std::numeric_limits<Double_t>::infinity());
+
+  for( Int_t i = 0; i < (Int_t)Panels.size(); ++i){
+    Panel &p = Panels.at(i);
+    Plotting *P = Base(p);
+    for( Int_t a = 0; a < 2; ++a){
+      p.UserRange[a][0] = P->UserAxisRange[a][0];
+      p.UserRange[a][1] = P->UserAxisRange[a][1];
+      p.Label[a] = P->AxisLabel[a];
+    }
+    if(p.type == 2) continue; //  The map keeps the range of its hist
+    P->ResetAxisRange();
+    P->AutoSetAxisRanges(p.logs[1]);
+    xlow.at(p.column) = TMath::Min(xlow.at(p.column), P->AxisRange[0][0]);
+    xup.at(p.column) = TMath::Max(xup.at(p.column), P->AxisRange[0][1]);
+    ylow.at(p.row) = TMath::Min(ylow.at(p.row), P->AxisRange[1][0]);
+    yup.at(p.row) = TMath::Max(yup.at(p.row), P->AxisRange[1][1]);
+  }
+
+  for( Int_t i = 0; i < (Int_t)Panels.size(); ++i){
+    Panel &p = Panels.at(i);
+    Plotting *P = Base(p);
+    //  The map keeps its own ranges, so it also keeps its titles
+    if(p.type != 2 && ShareX){
+      P->UserAxisRange[0][0] = xlow.at(p.column);
+      P->UserAxisRange[0][1] = xup.at(p.column);
+      if(p.row != Rows - 1) P->AxisLabel[0] = "";
+    }
+    if(p.type != 2 && ShareY){
+      P->UserAxisRange[1][0] = ylow.at(p.row);
+      P->UserAxisRange[1][1] = yup.at(p.row);
+      if(p.column != 0) P->AxisLabel[1] = "";
+    }
+    P->ResetAxisRange();
+  }
+}
+
+void PlottingGrid::ReleasePanels(){
+  for( Int_t i = 0; i < (Int_t)Panels.size(); ++i){
+    Panel &p = Panels.at(i);
+    Plotting *P = Base(p);
+    if(ShareX || ShareY){
+      for( Int_t a = 0; a < 2; ++a){
+        P->UserAxisRange[a][0] = p.UserRange[a][0];
+        P->UserAxisRange[a][1] = p.UserRange[a][1];
+        P->AxisLabel[a] = p.Label[a];
+      }
+    }
+    P->ReleaseHost(); //  Also resets the axis range
+  }
+}
+
+void PlottingGrid::Plot(TString name){
+
+  Profiler profile(this, "PlottingGrid", name); //  Times the phases if profiling is enabled
+
+  if(Panels.size() < 1) Abort("No panels added for plotting.");
+
+  //  Once per panel for the shared ranges and the drawing, the panels don't repeat it while they have a HostPad
+  for( Int_t i = 0; i < (Int_t)Panels.size(); ++i) Base(Panels.at(i))->Prepare();
+
+  profile.Phase(kCanvasPhase);
+  if(Canvas) CleanUp();
+  Canvas = NewCanvas(CanvasDimensions[0], CanvasDimensions[1]);
+
+  //  A panel that aborts (with SetThrowOnAbort) must not keep pointers into the deleted canvas
+  try{
+    if(ShareX || ShareY){
+      profile.Phase(kAxisPhase);
+      ShareAxes();
+    }
+
+    profile.Phase(kDrawPhase);
+    Int_t palette = -1;
+    for( Int_t i = 0; i < (Int_t)Panels.size(); ++i){
+      const Panel &p = Panels.at(i);
+      Canvas->cd();
+      TPad *pad = Own(new TPad(UniqueName("Panel"), "Panel", (Double_t)p.column / Columns, 1 - (Double_t)(p.row + 1) / Rows,
+                               (Double_t)(p.column + 1) / Columns, 1 - (Double_t)p.row / Rows));
+      pad->Draw();
+      Base(p)->HostPad = pad;
+      if(p.type == 1) Panels1D.at(p.index)->Plot("", p.logs[0], p.logs[1]);
+      else if(p.type == 2){
+        Panels2D.at(p.index)->Plot("", p.logs[0], p.logs[1], p.logs[2], p.numcontours);
+        palette = Panels2D.at(p.index)->Palette;
+      }
+      else PanelsRatio.at(p.index)->Plot("", p.logs[0], p.logs[1], p.logs[2]);
+      profile.Count(1);
+    }
+
+    Canvas->cd();
+    for( Int_t i = 0; i < (Int_t)Latex.size(); ++i) Latex.at(i)->Draw("same");
+    for( Int_t i = 0; i < (Int_t)lines.size(); ++i) lines.at(i)->Draw("same");
+    profile.Count(Latex.size() + lines.size());
+
+    //  All panels are written with a single SaveAs per format. What the panels drew is deleted with the grid (after the asynchronous writer is done with it)
+    profile.Phase(kExportPhase);
+    for( Int_t i = 0; i < (Int_t)Panels.size(); ++i){
+      std::vector<TObject*> &objects = Base(Panels.at(i))->PlotObjects;
+      PlotObjects.insert(PlotObjects.end(), objects.begin(), objects.end());
+      objects.clear();
+      std::vector<ContourSetting> &contours = Base(Panels.at(i))->Contours;
+      Contours.insert(Contours.end(), contours.begin(), contours.end());
+      contours.clear();
+    }
+    Export(name, palette);
+  }
+  catch(...){
+    ReleasePanels();
+    CleanUp();
+    throw;
+  }
+
+  ReleasePanels();
+  CleanUp();
+}
+
 #endif
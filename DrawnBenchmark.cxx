@@ -0,0 +1,621 @@
+//******************************************************************************
+// Benchmark of the plotting classes: time, memory and allocations per plot
+// Build: g++ -O2 DrawnBenchmark.cxx $(root-config --cflags --libs) -o DrawnBenchmark
+// Usage: ./DrawnBenchmark [-o results.csv|results.json] [-f pdf;png;svg] [-c 1D;2D;Ratio;Paint;Fast;Frame;Frame1000] [-r repetitions] [-d directory] [-q] [-k] [-s plots [-i interval] [-t kB]]
+//******************************************************************************
+//
+//  Every case plots synthetic hists, graphs and functions generated with TRandom (always with the same seed) and measures Plot() end to end:
+//  creating the plotting object, adding the objects, Plot() and deleting the object. Generating the data is not measured.
+//  Starting from a base case per class, one parameter at a time is swept, for every class and every format:
+//
+//    series  Number of hists (1D, Ratio: and as many ratios and graphs), lines, ellipses and latex in Paint
+//    bins    Bins of every hist (in 2D bins per axis)
+//    points  Points of every graph (1D only, 0 means no graphs)
+//    plots   Plots made one after the other in the same process (shows the cost of the first plot against the following ones)
+//
+//  Each repetition of a case runs in its own forked process, so the peak memory of one case does not hide the others.
+//  Per case the results contain the fastest and the mean time per plot, the peak resident memory and its increase over the
+//  memory before plotting (VmHWM and VmRSS), the allocations and allocated bytes per plot and the bytes written per plot.
+//  The class Fast is the 1D case written with Plotting1D::SetFastOutput (only svg is written without a TCanvas).
+//  The classes Frame and Frame1000 draw nothing but the axes of a plot on a canvas of the default size: Frame on the single-bin
+//  frame of Plotting::NewFrame, Frame1000 on the 1000x1000 TH2D that was booked as frame before. The difference of their
+//  allocated bytes per plot is what every pad of a plot saves (series draws as many frames one after the other).
+//
+//  A .csv output is appended to (the header is only written to a new file), so the same file collects the results of many runs
+//  and regressions show up as a change over time. Any other extension gets a JSON document of this run. -q runs a reduced sweep,
+//  -k keeps the plots in the directory (default: DrawnBenchmark_plots), otherwise they are deleted after measuring their size.
+//
+//  -s 100000 runs a soak instead of the sweep: per class and format a single plotting object is filled once and plotted 100000 times,
+//  with one bin of its hists changed before every plot. VmRSS is read every -i plots (default 1000). The largest value during the
+//  warm-up (the first tenth of the plots) is the baseline, and the soak fails as soon as VmRSS exceeds it by more than -t kB
+//  (default 2048). The result then is the growth over the baseline instead of the peak increase.
+
+#include "Drawn.h"
+#include "TError.h"
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//  Every operator new of the process (also inside ROOT) is counted
+std::atomic<Long64_t> Allocations(0);
+std::atomic<Long64_t> AllocatedBytes(0);
+
+void* operator new(size_t size){
+  Allocations++;
+  AllocatedBytes += size;
+  if(void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+//  One point of the sweep
+struct BenchCase{
+  TString type;  //  1D, 2D, Ratio, Paint, Fast (1D with SetFastOutput), Frame or Frame1000 (axes only, see above)
+  TString format;
+  TString sweep; //  The parameter that differs from the base case ("base" for the base case itself)
+  Int_t series = 1;
+  Int_t bins = 100;
+  Int_t points = 0;
+  Int_t plots = 1;
+};
+
+//  Outcome of one case, averaged over its repetitions
+struct BenchResult{
+  BenchCase bench;
+  Bool_t success = false;
+  TString message = "";
+  Double_t minSeconds = 0; //  Per plot
+  Double_t meanSeconds = 0;
+  Long64_t peakKB = 0; //  Largest VmHWM of all repetitions
+  Long64_t increaseKB = 0; //  Largest VmHWM - VmRSS before plotting
+  Double_t allocations = 0;  //  Per plot
+  Double_t allocatedBytes = 0;
+  Double_t fileBytes = 0;
+};
+
+//  The measurement of a single repetition, sent from the child to the main process
+struct Measurement{
+  Bool_t success = false;
+  TString message = "";
+  Double_t seconds = 0;
+  Long64_t peakKB = 0;
+  Long64_t increaseKB = 0;
+  Long64_t allocations = 0;
+  Long64_t allocatedBytes = 0;
+  Long64_t fileBytes = 0;
+};
+
+//  Value of a "Vm...:" line of /proc/self/status in kB (0 if not available)
+Long64_t ReadStatus(TString field){
+  std::ifstream in("/proc/self/status");
+  std::string line;
+  while(std::getline(in, line)){
+    TString l = line;
+    if(l.BeginsWith(field + ":")) return TString(l(field.Length() + 1, l.Length())).Strip(TString::kBoth).Atoll();
+  }
+  return 0;
+}
+
+//  Set VmHWM back to the current VmRSS (Linux >= 4.0), so the peak of the plotting alone is measured
+void ResetPeakMemory(){
+  std::ofstream clear("/proc/self/clear_refs");
+  clear << "5";
+}
+
+std::vector<TString> Split(TString s, const char* sep){
+  std::vector<TString> parts;
+  TObjArray *tokens = s.Tokenize(sep);
+  for(Int_t i = 0; i < tokens->GetEntries(); i++) parts.push_back(((TObjString*) tokens->At(i))->GetString());
+  delete tokens;
+  return parts;
+}
+
+//  Synthetic data of a case. It is owned here and only handed to the plotting objects
+class BenchData{
+  public:
+    BenchData(const BenchCase &c);
+    ~BenchData();
+
+    //  Change one bin of every hist, so a soak sees new data in every plot like a monitoring loop
+    void Touch(Int_t plot);
+
+    std::vector<TH1*> hists;
+    std::vector<TH1*> ratios;
+    std::vector<TGraph*> graphs;
+    std::vector<TF1*> funcs;
+    TH2 *map = nullptr;
+};
+
+BenchData::BenchData(const BenchCase &c){
+  TRandom random(4357);
+  TH1::AddDirectory(kFALSE);
+
+  if(c.type == "1D" || c.type == "Fast" || c.type == "Ratio"){
+    for(Int_t s = 0; s < c.series; s++){
+      TH1D *h = new TH1D(Form("hBench%d", s), "", c.bins, 0, 10);
+      for(Int_t i = 1; i <= c.bins; i++){
+        Double_t mean = 1000. * (1 + 0.1 * s) * TMath::Exp(-h->GetBinCenter(i) / 3.);
+        h->SetBinContent(i, random.Poisson(mean));
+        h->SetBinError(i, TMath::Sqrt(mean));
+      }
+      hists.push_back(h);
+    }
+  }
+
+  if(c.type == "Ratio"){
+    for(Int_t s = 0; s < c.series; s++){
+      TH1 *r = (TH1*) hists.at(s)->Clone(Form("hBenchRatio%d", s));
+      r->Divide(hists.at(0));
+      ratios.push_back(r);
+    }
+  }
+
+  if((c.type == "1D" || c.type == "Fast") && c.points > 0){
+    for(Int_t s = 0; s < c.series; s++){
+      TGraph *g = new TGraph(c.points);
+      for(Int_t i = 0; i < c.points; i++){
+        Double_t x = 10. * i / c.points;
+        g->SetPoint(i, x, 500. * (1 + TMath::Sin(x + s)) + random.Gaus(0, 20));
+      }
+      graphs.push_back(g);
+    }
+  }
+
+  if(c.type == "1D" || c.type == "Fast" || c.type == "Ratio"){
+    TF1 *f = new TF1("fBench", "[0]*exp(-x/[1])", 0, 10);
+    f->SetParameter(0, 1000);
+    f->SetParameter(1, 3);
+    funcs.push_back(f);
+  }
+
+  if(c.type == "2D"){
+    map = new TH2D("hBenchMap", "", c.bins, -5, 5, c.bins, -5, 5);
+    for(Int_t i = 1; i <= c.bins; i++){
+      for(Int_t j = 1; j <= c.bins; j++){
+        Double_t x = -5 + 10. * (i - 0.5) / c.bins;
+        Double_t y = -5 + 10. * (j - 0.5) / c.bins;
+        map->SetBinContent(i, j, 1000. * TMath::Exp(-(x * x + y * y) / 4.) + random.Uniform(10));
+      }
+    }
+  }
+}
+
+BenchData::~BenchData(){
+  for(TH1 *h : hists) delete h;
+  for(TH1 *h : ratios) delete h;
+  for(TGraph *g : graphs) delete g;
+  for(TF1 *f : funcs) delete f;
+  delete map;
+}
+
+//  Makes the protected frame of the plotting classes available to the Frame case
+class BenchFrame : public Plotting1D{
+  public:
+    using Plotting::NewFrame;
+};
+
+//  The frame that was booked for every pad before Plotting::NewFrame
+TH2D* NewFrame1000(TString name, Double_t xlow, Double_t xup, Double_t ylow, Double_t yup){
+  TDirectory::TContext NoDirectory(nullptr);
+  TH2D* frame = new TH2D(name, name, 1000, xlow, xup, 1000, ylow, yup);
+  frame->SetTitle("");
+  frame->SetStats(0);
+  return frame;
+}
+
+//  Add the objects of the case to a plotting object
+void FillPlotting(Plotting1D &P, const BenchCase &c, BenchData &data){
+  P.SetFormats(c.format);
+  P.SetFastOutput(c.type == "Fast");
+  for(Int_t i = 0; i < (Int_t)data.hists.size(); i++) P.NewHist(data.hists.at(i), Form("Hist %d", i));
+  for(Int_t i = 0; i < (Int_t)data.graphs.size(); i++) P.NewGraph(data.graphs.at(i), Form("Graph %d", i), -1, 1, -1, "l");
+  for(Int_t i = 0; i < (Int_t)data.funcs.size(); i++) P.NewFunc(data.funcs.at(i), "Fit");
+  P.SetAxisLabel("x", "Counts");
+  P.DrawLatex(0.5, 0.85, "Benchmark;synthetic data");
+}
+
+void FillPlotting(Plotting2D &P, const BenchCase &c, BenchData &data){
+  P.SetFormats(c.format);
+  P.NewHist(data.map);
+  P.SetAxisLabel("x", "y");
+}
+
+void FillPlotting(PlottingRatio &P, const BenchCase &c, BenchData &data){
+  P.SetFormats(c.format);
+  for(Int_t i = 0; i < (Int_t)data.hists.size(); i++) P.NewHist(data.hists.at(i), Form("Hist %d", i));
+  for(Int_t i = 0; i < (Int_t)data.ratios.size(); i++) P.NewRatio(data.ratios.at(i), Form("Ratio %d", i));
+  for(Int_t i = 0; i < (Int_t)data.funcs.size(); i++) P.NewTopFunc(data.funcs.at(i), "Fit");
+  P.SetAxisLabel("x", "Counts", "Ratio");
+}
+
+void FillPlotting(PlottingPaint &P, const BenchCase &c, BenchData &data){
+  P.SetFormats(c.format);
+  for(Int_t i = 0; i < c.series; i++){
+    Double_t t = (Double_t)i / c.series;
+    P.NewLine(0.1, 0.1 + 0.8 * t, 0.9, 0.9 - 0.8 * t, i % 2 ? -1 : 1);
+    P.NewAngle(0.5, 0.5, 0.1 + 0.3 * t, 0.05 + 0.2 * t, 0, 360. * (1 - t));
+    P.DrawLatex(0.05 + 0.9 * t, 0.95 - 0.9 * t, Form("%d", i));
+  }
+}
+
+void PlotFilled(Plotting1D &P, TString name){ P.Plot(name, false, true); }
+void PlotFilled(Plotting2D &P, TString name){ P.Plot(name); }
+void PlotFilled(PlottingRatio &P, TString name){ P.Plot(name, false, true); }
+void PlotFilled(PlottingPaint &P, TString name){ P.Plot(name); }
+
+void BenchData::Touch(Int_t plot){
+  for(TH1 *h : hists) h->SetBinContent(1 + plot % h->GetNbinsX(), h->GetBinContent(1 + (plot + 1) % h->GetNbinsX()));
+  if(map) map->SetBinContent(1 + plot % map->GetNbinsX(), 1 + plot / map->GetNbinsX() % map->GetNbinsY(), plot % 1000);
+}
+
+//  Create, fill and plot a single plotting object of the case
+void PlotOnce(const BenchCase &c, BenchData &data, TString name){
+  if(c.type == "1D" || c.type == "Fast") { Plotting1D P; FillPlotting(P, c, data); PlotFilled(P, name); }
+  else if(c.type == "2D") { Plotting2D P; FillPlotting(P, c, data); PlotFilled(P, name); }
+  else if(c.type == "Ratio") { PlottingRatio P; FillPlotting(P, c, data); PlotFilled(P, name); }
+  else if(c.type == "Paint") { PlottingPaint P; FillPlotting(P, c, data); PlotFilled(P, name); }
+  else if(c.type == "Frame" || c.type == "Frame1000"){
+    BenchFrame P;
+    TCanvas canvas("BenchCanvas", "BenchCanvas", 1200, 1000);
+    std::vector<TH2D*> frames;
+    for(Int_t i = 0; i < c.series; i++){
+      TString frameName = Form("BenchFrame%d", i);
+      TH2D *frame = c.type == "Frame" ? P.NewFrame(frameName, 0, 10, 0, 1000) : NewFrame1000(frameName, 0, 10, 0, 1000);
+      frame->GetXaxis()->SetTitle("x");
+      frame->GetYaxis()->SetTitle("Counts");
+      frame->Draw(i ? "SAME" : "");
+      frames.push_back(frame);
+    }
+    canvas.SaveAs(name + "." + c.format);
+    canvas.Clear();
+    for(TH2D *frame : frames) delete frame;
+  }
+  else throw std::runtime_error(Form("Unknown class '%s' (use 1D, 2D, Ratio, Paint, Fast, Frame or Frame1000)", c.type.Data()));
+}
+
+//  Run one repetition of a case in the current process
+Measurement Measure(const BenchCase &c, TString directory, Int_t index, Bool_t keep){
+  Measurement m;
+  try{
+    BenchData data(c);
+
+    ResetPeakMemory();
+    Long64_t baseKB = ReadStatus("VmRSS");
+    Long64_t allocations = Allocations;
+    Long64_t allocatedBytes = AllocatedBytes;
+    auto start = std::chrono::steady_clock::now();
+    for(Int_t p = 0; p < c.plots; p++) PlotOnce(c, data, Form("%s/case%d_%d", directory.Data(), index, p));
+    m.seconds = std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+    m.allocations = Allocations - allocations;
+    m.allocatedBytes = AllocatedBytes - allocatedBytes;
+    m.peakKB = ReadStatus("VmHWM");
+    m.increaseKB = m.peakKB - baseKB;
+
+    //  Size of everything written, measured outside the timing
+    for(Int_t p = 0; p < c.plots; p++){
+      TString file = Form("%s/case%d_%d.%s", directory.Data(), index, p, c.format.Data());
+      Long_t id, flags, modtime;
+      Long64_t size;
+      if(gSystem->GetPathInfo(file, &id, &size, &flags, &modtime) == 0) m.fileBytes += size;
+      if(!keep) gSystem->Unlink(file);
+    }
+    m.success = true;
+  }
+  catch(const std::exception &e){
+    m.message = e.what();
+  }
+  return m;
+}
+
+//  Plot one plotting object of the case c.plots times. VmRSS is read every interval plots. The largest value of the warm-up (the first
+//  tenth of the plots, at least one interval) is the baseline that no later value may exceed by more than toleranceKB
+template <class T>
+Measurement SoakPlotting(const BenchCase &c, TString directory, Int_t index, Int_t interval, Long64_t toleranceKB){
+  Measurement m;
+  BenchData data(c);
+  T P;
+  FillPlotting(P, c, data);
+  TString name = Form("%s/soak%d", directory.Data(), index);
+  Int_t warmup = std::max(interval, c.plots / 10);
+  Long64_t baseKB = 0;
+
+  Long64_t allocations = Allocations;
+  Long64_t allocatedBytes = AllocatedBytes;
+  auto start = std::chrono::steady_clock::now();
+  for(Int_t p = 1; p <= c.plots; p++){
+    data.Touch(p);
+    PlotFilled(P, name);
+    if(p % interval != 0 && p != c.plots) continue;
+
+    Long64_t rssKB = ReadStatus("VmRSS");
+    cout << Form("  %s %s plot %d: VmRSS %lld kB", c.type.Data(), c.format.Data(), p, rssKB) << endl;
+    m.peakKB = std::max(m.peakKB, rssKB);
+    if(p <= warmup){
+      baseKB = std::max(baseKB, rssKB);
+      continue;
+    }
+    m.increaseKB = std::max(m.increaseKB, rssKB - baseKB);
+    if(rssKB > baseKB + toleranceKB){
+      m.message = Form("VmRSS grew from %lld kB after the warm-up to %lld kB after %d plots", baseKB, rssKB, p);
+      return m;
+    }
+  }
+  m.seconds = std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+  m.allocations = Allocations - allocations;
+  m.allocatedBytes = AllocatedBytes - allocatedBytes;
+  m.success = true;
+  return m;
+}
+
+//  Run a soak of a case in the current process
+Measurement Soak(const BenchCase &c, TString directory, Int_t index, Int_t interval, Long64_t toleranceKB, Bool_t keep){
+  Measurement m;
+  try{
+    if(c.type == "1D" || c.type == "Fast") m = SoakPlotting<Plotting1D>(c, directory, index, interval, toleranceKB);
+    else if(c.type == "2D") m = SoakPlotting<Plotting2D>(c, directory, index, interval, toleranceKB);
+    else if(c.type == "Ratio") m = SoakPlotting<PlottingRatio>(c, directory, index, interval, toleranceKB);
+    else if(c.type == "Paint") m = SoakPlotting<PlottingPaint>(c, directory, index, interval, toleranceKB);
+    else throw std::runtime_error(Form("A soak needs a plotting class, not '%s' (use 1D, 2D, Ratio, Paint or Fast)", c.type.Data()));
+
+    TString file = Form("%s/soak%d.%s", directory.Data(), index, c.format.Data());
+    Long_t id, flags, modtime;
+    Long64_t size;
+    if(gSystem->GetPathInfo(file, &id, &size, &flags, &modtime) == 0) m.fileBytes = size * c.plots; //  Every plot overwrites the same file
+    if(!keep) gSystem->Unlink(file);
+  }
+  catch(const std::exception &e){
+    m.success = false;
+    m.message = e.what();
+  }
+  return m;
+}
+
+//  Measurements are sent from the children to the main process as a tab separated line
+TString FormatMeasurement(const Measurement &m){
+  TString message = m.message;
+  message.ReplaceAll("\t", " ");
+  message.ReplaceAll("\n", " ");
+  return TString::Format("%d\t%.9f\t%lld\t%lld\t%lld\t%lld\t%lld\t%s\n", (Int_t)m.success, m.seconds, m.peakKB, m.increaseKB,
+                         m.allocations, m.allocatedBytes, m.fileBytes, message.Data());
+}
+
+Measurement ParseMeasurement(TString line){
+  Measurement m;
+  std::vector<TString> fields = Split(line, "\t");
+  if(fields.size() < 7) { m.message = "No result from the benchmark process"; return m; }
+  m.success = fields.at(0).Atoi();
+  m.seconds = fields.at(1).Atof();
+  m.peakKB = fields.at(2).Atoll();
+  m.increaseKB = fields.at(3).Atoll();
+  m.allocations = fields.at(4).Atoll();
+  m.allocatedBytes = fields.at(5).Atoll();
+  m.fileBytes = fields.at(6).Atoll();
+  if(fields.size() > 7) m.message = fields.at(7);
+  return m;
+}
+
+//  Measure a case in a forked child, so it starts from the memory of the main process and a crash only fails this case
+Measurement MeasureInChild(std::function<Measurement()> measure){
+  Measurement m;
+  Int_t fd[2];
+  if(pipe(fd) != 0) { m.message = "Could not create pipe"; return m; }
+  pid_t pid = fork();
+  if(pid < 0) { m.message = "Could not fork"; return m; }
+  if(pid == 0){
+    close(fd[0]);
+    TString line = FormatMeasurement(measure());
+    if(write(fd[1], line.Data(), line.Length()) < 0) _exit(1);
+    close(fd[1]);
+    _exit(0);  //  Skip ROOTs teardown, the main process still owns everything
+  }
+  close(fd[1]);
+  std::string buffer;
+  char chunk[4096];
+  ssize_t n;
+  while((n = read(fd[0], chunk, sizeof(chunk))) > 0) buffer.append(chunk, n);
+  close(fd[0]);
+
+  Int_t status = 0;
+  waitpid(pid, &status, 0);
+  m = ParseMeasurement(buffer.c_str());
+  if(WIFSIGNALED(status)) m.message = Form("Crashed with signal %d", WTERMSIG(status));
+  return m;
+}
+
+//  The base case of every class and the values swept one at a time
+std::vector<BenchCase> MakeSweep(std::vector<TString> types, std::vector<TString> formats, Bool_t quick){
+  std::vector<Int_t> series = quick ? std::vector<Int_t>{1, 8} : std::vector<Int_t>{1, 4, 16, 64};
+  std::vector<Int_t> bins = quick ? std::vector<Int_t>{10, 10000} : std::vector<Int_t>{10, 1000, 100000, 1000000};
+  std::vector<Int_t> bins2D = quick ? std::vector<Int_t>{10, 300} : std::vector<Int_t>{10, 100, 1000, 3000};
+  std::vector<Int_t> points = quick ? std::vector<Int_t>{1000, 100000} : std::vector<Int_t>{1000, 100000, 1000000, 10000000};
+  std::vector<Int_t> plots = quick ? std::vector<Int_t>{10} : std::vector<Int_t>{10, 100};
+
+  std::vector<BenchCase> cases;
+  for(const TString &type : types){
+    for(const TString &format : formats){
+      BenchCase base;
+      base.type = type;
+      base.format = format;
+      base.sweep = "base";
+      base.series = type == "Paint" ? 10 : type.BeginsWith("Frame") ? 1 : 4;
+      cases.push_back(base);
+
+      for(Int_t v : series){
+        if(v == base.series) continue;
+        BenchCase c = base;
+        c.sweep = "series";
+        c.series = v;
+        cases.push_back(c);
+      }
+      for(Int_t v : (type == "2D" ? bins2D : bins)){
+        if(type == "Paint" || type.BeginsWith("Frame") || v == base.bins) continue;
+        BenchCase c = base;
+        c.sweep = "bins";
+        c.bins = v;
+        cases.push_back(c);
+      }
+      for(Int_t v : points){
+        if(type != "1D" && type != "Fast") continue;
+        BenchCase c = base;
+        c.sweep = "points";
+        c.points = v;
+        cases.push_back(c);
+      }
+      for(Int_t v : plots){
+        BenchCase c = base;
+        c.sweep = "plots";
+        c.plots = v;
+        cases.push_back(c);
+      }
+    }
+  }
+  return cases;
+}
+
+//  One soak per plotting class and format, with the base case of the sweep
+std::vector<BenchCase> MakeSoak(std::vector<TString> types, std::vector<TString> formats, Int_t plots){
+  std::vector<BenchCase> cases;
+  for(const TString &type : types){
+    if(type.BeginsWith("Frame")) continue;  //  Draws no plotting object that could be reused
+    for(const TString &format : formats){
+      BenchCase c;
+      c.type = type;
+      c.format = format;
+      c.sweep = "soak";
+      c.series = type == "Paint" ? 10 : 4;
+      c.plots = plots;
+      cases.push_back(c);
+    }
+  }
+  return cases;
+}
+
+//  Appends to an existing csv, so one file holds the history of many runs
+void WriteCSV(TString output, TString timestamp, const std::vector<BenchResult> &results){
+  Bool_t exists = !gSystem->AccessPathName(output);
+  std::ofstream out(output.Data(), std::ios::app);
+  if(!exists) out << "timestamp,class,format,sweep,series,bins,points,plots,status,seconds_min,seconds_mean,peak_rss_kb,rss_increase_kb,"
+                     "allocations,allocated_bytes,file_bytes,message\n";
+  for(const BenchResult &r : results){
+    TString message = r.message;
+    message.ReplaceAll("\"", "'");
+    out << Form("%s,%s,%s,%s,%d,%d,%d,%d,%s,%.9f,%.9f,%lld,%lld,%.1f,%.1f,%.1f,\"%s\"\n", timestamp.Data(), r.bench.type.Data(),
+                r.bench.format.Data(), r.bench.sweep.Data(), r.bench.series, r.bench.bins, r.bench.points, r.bench.plots, r.success ? "ok" : "failed",
+                r.minSeconds, r.meanSeconds, r.peakKB, r.increaseKB, r.allocations, r.allocatedBytes, r.fileBytes, message.Data());
+  }
+}
+
+void WriteJSON(TString output, TString timestamp, Int_t repetitions, const std::vector<BenchResult> &results){
+  std::ofstream out(output.Data());
+  out << "{\n  \"timestamp\": \"" << timestamp << "\",\n  \"repetitions\": " << repetitions << ",\n  \"results\": [\n";
+  for(Int_t i = 0; i < (Int_t)results.size(); i++){
+    const BenchResult &r = results.at(i);
+    TString message = r.message;
+    message.ReplaceAll("\\", "\\\\");
+    message.ReplaceAll("\"", "\\\"");
+    out << Form("    {\"class\": \"%s\", \"format\": \"%s\", \"sweep\": \"%s\", \"series\": %d, \"bins\": %d, \"points\": %d, \"plots\": %d, "
+                "\"status\": \"%s\", \"seconds_min\": %.9f, \"seconds_mean\": %.9f, \"peak_rss_kb\": %lld, \"rss_increase_kb\": %lld, "
+                "\"allocations\": %.1f, \"allocated_bytes\": %.1f, \"file_bytes\": %.1f, \"message\": \"%s\"}%s\n",
+                r.bench.type.Data(), r.bench.format.Data(), r.bench.sweep.Data(), r.bench.series, r.bench.bins, r.bench.points, r.bench.plots,
+                r.success ? "ok" : "failed", r.minSeconds, r.meanSeconds, r.peakKB, r.increaseKB, r.allocations, r.allocatedBytes, r.fileBytes,
+                message.Data(), i + 1 < (Int_t)results.size() ? "," : "");
+  }
+  out << "  ]\n}\n";
+}
+
+int main(int argc, char **argv){
+
+  TString output = "DrawnBenchmark.csv";
+  TString formats = "pdf;png;svg";
+  TString types = "1D;2D;Ratio;Paint;Frame;Frame1000";
+  TString directory = "DrawnBenchmark_plots";
+  Int_t repetitions = 3;
+  Bool_t quick = false;
+  Bool_t keep = false;
+  Int_t soak = 0;
+  Int_t interval = 1000;
+  Long64_t toleranceKB = 2048;
+  for(Int_t i = 1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg == "-o" && i + 1 < argc) output = argv[++i];
+    else if(arg == "-f" && i + 1 < argc) formats = argv[++i];
+    else if(arg == "-c" && i + 1 < argc) types = argv[++i];
+    else if(arg == "-r" && i + 1 < argc) repetitions = TString(argv[++i]).Atoi();
+    else if(arg == "-d" && i + 1 < argc) directory = argv[++i];
+    else if(arg == "-q") quick = true;
+    else if(arg == "-k") keep = true;
+    else if(arg == "-s" && i + 1 < argc) soak = TString(argv[++i]).Atoi();
+    else if(arg == "-i" && i + 1 < argc) interval = std::max(1, TString(argv[++i]).Atoi());
+    else if(arg == "-t" && i + 1 < argc) toleranceKB = TString(argv[++i]).Atoll();
+    else{
+      cerr << "Usage: " << argv[0] << " [-o results.csv|results.json] [-f pdf;png;svg] [-c 1D;2D;Ratio;Paint;Fast;Frame;Frame1000] [-r repetitions] [-d directory] [-q] [-k] [-s plots [-i interval] [-t kB]]" << endl;
+      return 1;
+    }
+  }
+  if(repetitions < 1) repetitions = 1;
+
+  gROOT->SetBatch(kTRUE);
+  gErrorIgnoreLevel = kWarning; //  Don't print a line for every created file
+  Plotting::SetThrowOnAbort(true);
+
+  gSystem->mkdir(directory, kTRUE);
+
+  //  Pay ROOTs one-time costs (libraries, fonts) before forking, so no case measures them
+  {
+    BenchCase warmup;
+    warmup.type = "1D";
+    warmup.format = "pdf";
+    Measure(warmup, directory, -1, false);
+  }
+
+  std::vector<BenchCase> cases = soak > 0 ? MakeSoak(Split(types, ";"), Split(formats, ";"), soak) : MakeSweep(Split(types, ";"), Split(formats, ";"), quick);
+  if(soak > 0) repetitions = 1;
+  std::vector<BenchResult> results;
+  for(Int_t i = 0; i < (Int_t)cases.size(); i++){
+    BenchResult r;
+    r.bench = cases.at(i);
+    r.success = true;
+    r.minSeconds = std::numeric_limits<Double_t>::infinity();
+    for(Int_t rep = 0; rep < repetitions && r.success; rep++){
+      const BenchCase &c = r.bench;
+      Measurement m = MeasureInChild([&](){ return soak > 0 ? Soak(c, directory, i, interval, toleranceKB, keep) : Measure(c, directory, i, keep); });
+      if(!m.success){
+        r.success = false;
+        r.message = m.message;
+        break;
+      }
+      Double_t perPlot = m.seconds / r.bench.plots;
+      r.minSeconds = TMath::Min(r.minSeconds, perPlot);
+      r.meanSeconds += perPlot / repetitions;
+      r.peakKB = std::max(r.peakKB, m.peakKB);
+      r.increaseKB = std::max(r.increaseKB, m.increaseKB);
+      r.allocations += (Double_t)m.allocations / r.bench.plots / repetitions;
+      r.allocatedBytes += (Double_t)m.allocatedBytes / r.bench.plots / repetitions;
+      r.fileBytes += (Double_t)m.fileBytes / r.bench.plots / repetitions;
+    }
+    if(!r.success) r.minSeconds = r.meanSeconds = 0;
+    results.push_back(r);
+
+    cout << Form("[%d/%d] %-5s %-4s %-6s series=%-3d bins=%-7d points=%-8d plots=%-3d ", i + 1, (Int_t)cases.size(), r.bench.type.Data(),
+                 r.bench.format.Data(), r.bench.sweep.Data(), r.bench.series, r.bench.bins, r.bench.points, r.bench.plots);
+    if(r.success && soak > 0) cout << Form("%9.4f s/plot %8lld kB peak %8lld kB growth %10.0f allocs/plot", r.minSeconds, r.peakKB, r.increaseKB, r.allocations) << endl;
+    else if(r.success) cout << Form("%9.4f s/plot %8lld kB peak %10.0f allocs/plot %10.0f bytes/plot", r.minSeconds, r.peakKB, r.allocations, r.fileBytes) << endl;
+    else cout << "failed: " << r.message << endl;
+  }
+
+  char timestamp[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+  if(output.EndsWith(".csv")) WriteCSV(output, timestamp, results);
+  else WriteJSON(output, timestamp, repetitions, results);
+  cout << "Results written to " << output << endl;
+
+  for(const BenchResult &r : results) if(!r.success) return 1;
+  return 0;
+}
@@ -0,0 +1,344 @@
+//******************************************************************************
+// Booking many plots from tree expressions and filling them in one event loop
+// Usage: #include "DrawnBook.h" (needs RDataFrame, ROOT 6.22 or newer)
+//******************************************************************************
+//
+//  PlottingBook Book("Events", "data/run1*.root;data/run2*.root");
+//  Book.SetCut("nTracks > 0");
+//  Int_t hPt = Book.Hist1D("pt", 100, 0, 20);
+//  Int_t hPtCentral = Book.Hist1D("pt", 100, 0, 20, "abs(eta) < 0.8");
+//  Plotting1D &P = Book.Plot1D("Pt.pdf", {hPt, hPtCentral}, {"all", "|#eta| < 0.8"}, false, true);
+//  P.SetAxisLabel("#it{p}_{T} (GeV/#it{c})", "Counts");
+//  Book.Run(); //  A single multi-threaded loop over the tree fills every hist, then all plots are produced
+//
+//  Identical expressions and cuts are only evaluated once per event, no matter how many hists use them.
+
+#ifndef DRAWNBOOK
+#define DRAWNBOOK
+
+#include "Drawn.h"
+#include "ROOT/RDataFrame.hxx"
+#include <memory>
+
+class PlottingBook{
+  public:
+
+    //  files: one or more file names or globs, separated by ;
+    PlottingBook(TString treename, TString files);
+
+    ~PlottingBook();
+
+    //  The booked hists and plots can't be shared
+    PlottingBook(const PlottingBook&) = delete;
+    PlottingBook& operator=(const PlottingBook&) = delete;
+
+    //  A cut and a weight that are applied to every booked hist (in addition to their own)
+    void SetCut(TString cut = "");
+    void SetWeight(TString weight = "");
+
+    //  Book a histogram of a tree expression that is filled in Run(). Returns its number, which is given to the Plot.. functions
+    Int_t Hist1D(TString expr, Int_t nbins, Double_t xlow, Double_t xup, TString cut = "", TString weight = "");
+    Int_t Hist2D(TString exprx, TString expry, Int_t nbinsx, Double_t xlow, Double_t xup, Int_t nbinsy, Double_t ylow, Double_t yup, TString cut = "", TString weight = "");
+
+    //  Book a plot of booked hists that Run() saves as name. The returned plotting object can be configured as usual (SetAxisLabel, DrawLatex, NewFunc, ...).
+    //  The hists are added by Run() with NewHist, using labels and opts (missing entries: no label and "p") and the auto styles
+    Plotting1D& Plot1D(TString name, std::vector<Int_t> hists, std::vector<TString> labels = {}, Bool_t logx = false, Bool_t logy = false, std::vector<TString> opts = {});
+    Plotting2D& Plot2D(TString name, Int_t hist, Bool_t logx = false, Bool_t logy = false, Bool_t logz = false, Int_t palette = kBird);
+
+    //  All hists on the upper pad. On the lower pad every other hist divided by hists[denominator]
+    PlottingRatio& PlotRatio(TString name, std::vector<Int_t> hists, std::vector<TString> labels = {}, Int_t denominator = 0, Bool_t logx = false, Bool_t logy = false, Bool_t logz = false, std::vector<TString> opts = {});
+
+    //  Fill all booked hists in one event loop (nthreads: 0 all cores, 1 sequential) and produce all booked plots in the order they were booked.
+    //  ROOTs implicit multi-threading is only enabled during the loop, unless it was enabled before
+    void Run(Int_t nthreads = 0);
+
+    //  Hist number i, filled by Run()
+    TH1* GetHist(Int_t i);
+
+  private:
+
+    TString TreeName;
+    TString Files;
+    TString Cut = "";
+    TString Weight = "";
+
+    struct BookedHist{
+      Int_t dimension;
+      TString expr[2];
+      Int_t nbins[2] = {1, 1};
+      Double_t low[2] = {0, 0};
+      Double_t up[2] = {1, 1};
+      TString cut;
+      TString weight;
+    };
+    std::vector<BookedHist> BookedHists;
+
+    struct BookedPlot{
+      Int_t type;  //  1: Plotting1D, 2: Plotting2D, 3: PlottingRatio
+      Int_t index;  //  In Plots1D, Plots2D or PlotsRatio
+      TString name;
+      std::vector<Int_t> hists;
+      std::vector<TString> labels;
+      std::vector<TString> opts;
+      Int_t denominator = 0;
+      Bool_t logs[3] = {false, false, false};
+      Int_t palette = kBird;
+    };
+    std::vector<BookedPlot> BookedPlots;
+
+    //  The results of the event loop. The hists belong to them
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> Results1D;
+    std::vector<ROOT::RDF::RResultPtr<TH2D>> Results2D;
+    std::vector<TH1*> Filled; //  Hist number i, pointing into the results
+
+    //  Declared after the hists, so they are deleted before the hists they plot
+    std::vector<std::unique_ptr<Plotting1D>> Plots1D;
+    std::vector<std::unique_ptr<Plotting2D>> Plots2D;
+    std::vector<std::unique_ptr<PlottingRatio>> PlotsRatio;
+
+    //  Checks the hist numbers given to a Plot.. function
+    void CheckHists(const std::vector<Int_t> &hists, Int_t dimension, TString caller);
+
+    //  Aborts if a hist is booked without an expression
+    void CheckExpression(TString expr, TString caller);
+
+    //  Define every expression and weight as a column and book all hists on the data frame, then run the loop
+    void Fill();
+
+};
+
+PlottingBook::PlottingBook(TString treename, TString files){
+  TreeName = treename;
+  Files = files;
+}
+
+PlottingBook::~PlottingBook(){
+
+}
+
+void PlottingBook::SetCut(TString cut){
+  Cut = cut;
+}
+
+void PlottingBook::SetWeight(TString weight){
+  Weight = weight;
+}
+
+void PlottingBook::CheckExpression(TString expr, TString caller){
+  if(!expr.Strip(TString::kBoth).Length()) Plotting::Abort(Form("%s was given an empty expression for hist number %d.", caller.Data(), (Int_t)BookedHists.size()));
+}
+
+Int_t PlottingBook::Hist1D(TString expr, Int_t nbins, Double_t xlow, Double_t xup, TString cut, TString weight){
+  CheckExpression(expr, "Hist1D");
+  BookedHist h;
+  h.dimension = 1;
+  h.expr[0] = expr;
+  h.nbins[0] = nbins;
+  h.low[0] = xlow;
+  h.up[0] = xup;
+  h.cut = cut;
+  h.weight = weight;
+  BookedHists.push_back(h);
+  return BookedHists.size() - 1;
+}
+
+Int_t PlottingBook::Hist2D(TString exprx, TString expry, Int_t nbinsx, Double_t xlow, Double_t xup, Int_t nbinsy, Double_t ylow, Double_t yup, TString cut, TString weight){
+  CheckExpression(exprx, "Hist2D");
+  CheckExpression(expry, "Hist2D");
+  BookedHist h;
+  h.dimension = 2;
+  h.expr[0] = exprx;
+  h.expr[1] = expry;
+  h.nbins[0] = nbinsx;
+  h.nbins[1] = nbinsy;
+  h.low[0] = xlow;
+  h.low[1] = ylow;
+  h.up[0] = xup;
+  h.up[1] = yup;
+  h.cut = cut;
+  h.weight = weight;
+  BookedHists.push_back(h);
+  return BookedHists.size() - 1;
+}
+
+void PlottingBook::CheckHists(const std::vector<Int_t> &hists, Int_t dimension, TString caller){
+  if(hists.size() < 1) Plotting::Abort(caller + " was given no hists.");
+  for(Int_t i = 0; i < (Int_t)hists.size(); ++i){
+    if(hists.at(i) < 0 || hists.at(i) >= (Int_t)BookedHists.size()) Plotting::Abort(Form("%s was given the unknown hist number %d.", caller.Data(), hists.at(i)));
+    if(BookedHists.at(hists.at(i)).dimension != dimension) Plotting::Abort(Form("%s was given hist number %d, which is not %dD.", caller.Data(), hists.at(i), dimension));
+  }
+}
+
+Plotting1D& PlottingBook::Plot1D(TString name, std::vector<Int_t> hists, std::vector<TString> labels, Bool_t logx, Bool_t logy, std::vector<TString> opts){
+  CheckHists(hists, 1, "Plot1D");
+  BookedPlot p;
+  p.type = 1;
+  p.index = Plots1D.size();
+  p.name = name;
+  p.hists = hists;
+  p.labels = labels;
+  p.opts = opts;
+  p.logs[0] = logx;
+  p.logs[1] = logy;
+  BookedPlots.push_back(p);
+  Plots1D.emplace_back(new Plotting1D());
+  return *Plots1D.back();
+}
+
+Plotting2D& PlottingBook::Plot2D(TString name, Int_t hist, Bool_t logx, Bool_t logy, Bool_t logz, Int_t palette){
+  CheckHists({hist}, 2, "Plot2D");
+  BookedPlot p;
+  p.type = 2;
+  p.index = Plots2D.size();
+  p.name = name;
+  p.hists = {hist};
+  p.logs[0] = logx;
+  p.logs[1] = logy;
+  p.logs[2] = logz;
+  p.palette = palette;
+  BookedPlots.push_back(p);
+  Plots2D.emplace_back(new Plotting2D());
+  return *Plots2D.back();
+}
+
+PlottingRatio& PlottingBook::PlotRatio(TString name, std::vector<Int_t> hists, std::vector<TString> labels, Int_t denominator, Bool_t logx, Bool_t logy, Bool_t logz, std::vector<TString> opts){
+  CheckHists(hists, 1, "PlotRatio");
+  if(hists.size() < 2) Plotting::Abort("PlotRatio needs at least two hists.");
+  if(denominator < 0 || denominator >= (Int_t)hists.size()) Plotting::Abort("PlotRatio was given a denominator that is not one of its hists.");
+  BookedPlot p;
+  p.type = 3;
+  p.index = PlotsRatio.size();
+  p.name = name;
+  p.hists = hists;
+  p.labels = labels;
+  p.opts = opts;
+  p.denominator = denominator;
+  p.logs[0] = logx;
+  p.logs[1] = logy;
+  p.logs[2] = logz;
+  BookedPlots.push_back(p);
+  PlotsRatio.emplace_back(new PlottingRatio());
+  return *PlotsRatio.back();
+}
+
+TH1* PlottingBook::GetHist(Int_t i){
+  if(i < 0 || i >= (Int_t)Filled.size()) Plotting::Abort(Form("GetHist was given hist number %d, but only %d hists were filled.", i, (Int_t)Filled.size()));
+  return Filled.at(i);
+}
+
+void PlottingBook::Fill(){
+
+  std::vector<std::string> files;
+  TObjArray *tokens = Files.Tokenize(";");
+  for(Int_t i = 0; i < tokens->GetEntries(); ++i) files.push_back(((TObjString*) tokens->At(i))->GetString().Strip(TString::kBoth).Data());
+  delete tokens;
+
+  ROOT::RDataFrame df(TreeName.Data(), files);
+  ROOT::RDF::RNode all = df;
+  if(Cut.Length()) all = all.Filter(Cut.Data());
+
+  //  Every distinct expression and weight becomes one column, so it is evaluated once per event. They are all defined before any hist is booked,
+  //  because the nodes of the cuts only know the columns defined before them
+  std::map<TString, std::string> columns;
+  auto define = [&](TString expr, Int_t hist){
+    if(!expr.Length() || columns.count(expr)) return;
+    std::string column = Form("DrawnBookColumn%d", (Int_t)columns.size());
+    try{
+      all = all.Define(column, expr.Data());
+    }
+    catch(const std::exception &e){ //  The expression is compiled here, e.g. a misspelled branch
+      Plotting::Abort(Form("Hist number %d has the expression \"%s\", which can't be evaluated: %s", hist, expr.Data(), e.what()));
+    }
+    columns[expr] = column;
+  };
+  std::vector<TString> weights;
+  for(Int_t i = 0; i < (Int_t)BookedHists.size(); ++i){
+    const BookedHist &h = BookedHists.at(i);
+    for(Int_t k = 0; k < h.dimension; ++k) define(h.expr[k], i);
+    TString weight = Weight;
+    if(h.weight.Length()) weight = weight.Length() ? "(" + weight + ")*(" + h.weight + ")" : h.weight;
+    define(weight, i);
+    weights.push_back(weight);
+  }
+
+  //  Hists with the same cut share its filter node
+  std::map<TString, ROOT::RDF::RNode> cuts;
+  std::vector<Int_t> result; //  Index into Results1D or Results2D for every hist
+  for(Int_t i = 0; i < (Int_t)BookedHists.size(); ++i){
+    const BookedHist &h = BookedHists.at(i);
+    if(h.cut.Length() && !cuts.count(h.cut)) cuts.emplace(h.cut, all.Filter(h.cut.Data()));
+    ROOT::RDF::RNode node = h.cut.Length() ? cuts.at(h.cut) : all;
+    TString name = Form("DrawnBookHist%d", i);
+    if(h.dimension == 1){
+      ROOT::RDF::TH1DModel model(name, "", h.nbins[0], h.low[0], h.up[0]);
+      result.push_back(Results1D.size());
+      Results1D.push_back(weights.at(i).Length() ? node.Histo1D(model, columns.at(h.expr[0]), columns.at(weights.at(i))) : node.Histo1D(model, columns.at(h.expr[0])));
+    }
+    else{
+      ROOT::RDF::TH2DModel model(name, "", h.nbins[0], h.low[0], h.up[0], h.nbins[1], h.low[1], h.up[1]);
+      result.push_back(Results2D.size());
+      Results2D.push_back(weights.at(i).Length() ? node.Histo2D(model, columns.at(h.expr[0]), columns.at(h.expr[1]), columns.at(weights.at(i)))
+                                                 : node.Histo2D(model, columns.at(h.expr[0]), columns.at(h.expr[1])));
+    }
+  }
+
+  //  The first access runs the event loop for all booked hists at once. Expressions that only fail when they are compiled right before it are reported here
+  try{
+    for(Int_t i = 0; i < (Int_t)BookedHists.size(); ++i){
+      if(BookedHists.at(i).dimension == 1) Filled.push_back(Results1D.at(result.at(i)).GetPtr());
+      else Filled.push_back(Results2D.at(result.at(i)).GetPtr());
+    }
+  }
+  catch(const std::exception &e){
+    Filled.clear();
+    Plotting::Abort(Form("The loop over %s failed: %s", TreeName.Data(), e.what()));
+  }
+}
+
+void PlottingBook::Run(Int_t nthreads){
+
+  if(Filled.size() > 0) Plotting::Abort("Run can only be called once.");
+  if(BookedHists.size() < 1) Plotting::Abort("No hists booked.");
+
+  //  Implicit multi-threading is global in ROOT (every RDataFrame of the process uses it), so it is switched off again after the loop unless it was on before
+  Bool_t enableMT = nthreads != 1 && !ROOT::IsImplicitMTEnabled();
+  if(enableMT) ROOT::EnableImplicitMT(nthreads > 1 ? nthreads : 0);
+  try{
+    Fill();
+  }
+  catch(...){
+    if(enableMT) ROOT::DisableImplicitMT();
+    throw;
+  }
+  if(enableMT) ROOT::DisableImplicitMT();
+
+  for(Int_t i = 0; i < (Int_t)BookedPlots.size(); ++i){
+    const BookedPlot &p = BookedPlots.at(i);
+    auto label = [&](Int_t j) { return j < (Int_t)p.labels.size() ? p.labels.at(j) : TString(""); };
+    auto opt = [&](Int_t j) { return j < (Int_t)p.opts.size() ? p.opts.at(j) : TString("p"); };
+
+    if(p.type == 1){
+      Plotting1D &P = *Plots1D.at(p.index);
+      for(Int_t j = 0; j < (Int_t)p.hists.size(); ++j) P.NewHist(Filled.at(p.hists.at(j)), label(j), -1, 1, -1, opt(j));
+      P.Plot(p.name, p.logs[0], p.logs[1]);
+    }
+    else if(p.type == 2){
+      Plotting2D &P = *Plots2D.at(p.index);
+      P.NewHist(static_cast<TH2*>(Filled.at(p.hists.at(0))), "COLZ", p.palette);
+      P.Plot(p.name, p.logs[0], p.logs[1], p.logs[2]);
+    }
+    else{
+      PlottingRatio &P = *PlotsRatio.at(p.index);
+      TH1 *denominator = Filled.at(p.hists.at(p.denominator));
+      for(Int_t j = 0; j < (Int_t)p.hists.size(); ++j){
+        TH1 *h = Filled.at(p.hists.at(j));
+        P.NewHist(h, label(j), -1, 1, -1, opt(j));
+        if(j == p.denominator) continue;
+        P.NewRatio(h, denominator, (label(j).Length() && label(p.denominator).Length()) ? label(j) + " / " + label(p.denominator) : label(j), -1, 1, -1, opt(j));
+      }
+      P.Plot(p.name, p.logs[0], p.logs[1], p.logs[2]);
+    }
+  }
+}
+
+#endif
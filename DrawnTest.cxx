@@ -0,0 +1,93 @@
+//******************************************************************************
+// Tests of the plotting classes: plots small known inputs and checks what was drawn
+// Build: g++ -O2 DrawnTest.cxx $(root-config --cflags --libs) -o DrawnTest
+// Usage: ./DrawnTest
+//******************************************************************************
+//
+//  Every check plots into memory (SetMemoryOutput and SetOutputDirectory with a TMemFile), reads the canvas back and compares it with
+//  what the inputs have to give. One line per check is printed and the exit code is 1 if any check failed.
+//
+//  GridBand  A panel with a band and a panel with a hist share one row of a PlottingGrid. The shared y range has to be taken from the
+//            computed band (far away from 0), not from the empty placeholder the band has before its first Plot().
+
+#include "Drawn.h"
+#include "TError.h"
+#include "TMemFile.h"
+#include <functional>
+
+//  The y range of each panel of the grid plot name in file, read from the frame drawn into its pad
+std::vector<std::pair<Double_t, Double_t>> PanelRanges(TDirectory &file, TString name){
+  std::vector<std::pair<Double_t, Double_t>> ranges;
+  TPad *canvas = dynamic_cast<TPad*>(file.Get(name));
+  if(!canvas) return ranges;
+  TIter pads(canvas->GetListOfPrimitives());
+  while(TObject *o = pads()){
+    TPad *pad = dynamic_cast<TPad*>(o);
+    if(!pad) continue;
+    TIter objects(pad->GetListOfPrimitives());
+    while(TObject *p = objects()){
+      TH2 *frame = dynamic_cast<TH2*>(p);
+      if(frame && TString(frame->GetName()).BeginsWith("hDummy")){
+        ranges.push_back({frame->GetYaxis()->GetXmin(), frame->GetYaxis()->GetXmax()});
+        break;
+      }
+    }
+  }
+  delete canvas;
+  return ranges;
+}
+
+//  See GridBand above. Returns an empty message if the shared ranges are right
+TString CheckGridBand(){
+  TDirectory::TContext NoDirectory(nullptr);
+  TH1D nominal("GridNominal", "", 10, 10, 20), up("GridUp", "", 10, 10, 20), down("GridDown", "", 10, 10, 20), other("GridOther", "", 10, 10, 20);
+  for(Int_t i = 1; i <= 10; i++){
+    nominal.SetBinContent(i, 100 + i);
+    up.SetBinContent(i, 110 + i);
+    down.SetBinContent(i, 90 + i);
+    other.SetBinContent(i, 105 + i);
+  }
+
+  TMemFile file("GridBand.root", "RECREATE");
+  {
+    PlottingGrid grid(2, 1);
+    grid.SetSharedAxes(false, true);
+    grid.SetFormats("png");
+    grid.SetMemoryOutput();
+    grid.SetOutputDirectory(&file);
+    grid.Panel1D(0, 0).NewBand(&nominal, {&up, &down}, "Band");
+    grid.Panel1D(1, 0).NewHist(&other, "Hist");
+    grid.Plot("GridBand");
+  }
+
+  std::vector<std::pair<Double_t, Double_t>> ranges = PanelRanges(file, "GridBand");
+  if(ranges.size() != 2) return Form("Found %d of the 2 panel frames.", (Int_t)ranges.size());
+  if(ranges.at(0) != ranges.at(1)) return Form("The panels do not share the y range: [%g,%g] and [%g,%g].", ranges.at(0).first, ranges.at(0).second, ranges.at(1).first, ranges.at(1).second);
+  if(ranges.at(0).first <= 0 || ranges.at(0).first > 91 || ranges.at(0).second < 120) return Form("The shared y range [%g,%g] does not fit the band [91,120].", ranges.at(0).first, ranges.at(0).second);
+  return "";
+}
+
+int main(){
+
+  gROOT->SetBatch(kTRUE);
+  gErrorIgnoreLevel = kWarning; //  Don't print a line for every created file
+  Plotting::SetThrowOnAbort(true);
+
+  std::vector<std::pair<TString, std::function<TString()>>> checks = {
+    {"GridBand", CheckGridBand}
+  };
+
+  Int_t nfailed = 0;
+  for(Int_t i = 0; i < (Int_t)checks.size(); i++){
+    TString message;
+    try{
+      message = checks.at(i).second();
+    }
+    catch(const std::exception &e){
+      message = e.what();
+    }
+    cout << Form("%-10s ", checks.at(i).first.Data()) << (message.Length() ? "failed: " + message : TString("ok")) << endl;
+    if(message.Length()) nfailed++;
+  }
+  return nfailed > 0 ? 1 : 0;
+}
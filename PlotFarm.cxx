@@ -0,0 +1,432 @@
+//******************************************************************************
+// Plot farm: renders all plots described in a manifest with N worker processes
+// Build: g++ -O2 PlotFarm.cxx $(root-config --cflags --libs) -o PlotFarm
+// Usage: ./PlotFarm manifest.txt [-j workers] [-s summary.tsv] [-c cacheindex]
+//******************************************************************************
+//
+//  Every non-empty line of the manifest that does not start with # describes one plot.
+//  The fields of a line are separated by | and given as key=value (wrapped here, but it has to be a single line):
+//
+//    class=Ratio | output=plots/pt | formats=pdf;png | hist=data.root:hPt | label=Data | hist=mc.root:hPt | label=MC | opt=h
+//    | ratio=ratio.root:hRatio | xlabel=p_{T} (GeV/c) | ylabel=Counts | logy=1 | latex=0.6,0.9,ALICE;pp #sqrt{s} = 13 TeV
+//
+//  class     1D, 2D or Ratio
+//  output    Name given to Plot(). With formats (see SetFormats) the extension can be omitted
+//  hist      file:key of a histogram. In 2D this is the TH2 to plot. The file can contain ':' (e.g. root://), the key is after the last one
+//  graph     file:key of a TGraph (1D only)
+//  func      file:key of a TF1 (1D and 2D; in Ratio it is drawn on the upper pad)
+//  botfunc   file:key of a TF1 drawn on the ratio pad
+//  ratio     file:key of a histogram drawn on the ratio pad
+//  label, style, size, color, opt  Arguments of the New.. call of the last added hist/graph/func/ratio (for the 2D hist style is the palette)
+//  xlabel, ylabel, zlabel, xoffset, yoffset  Axis labels (zlabel is the ratio label) and their offsets
+//  range     xlow,xup,ylow,yup[,zlow,zup] as in SetAxisRange
+//  margins   low,left,up,right[,cw,ch] as in SetMargins
+//  legend, legendr  x1,x2,y1,y2 as in SetLegend and SetLegendR
+//  logx, logy, logz, contours  Arguments of Plot()
+//  latex     x,y,text as in DrawLatex (the text may contain commas and ; for new lines)
+//  theme     Classic, OkabeIto, TolBright or TolMuted (see Themes in Drawn.h), hashlabels=1 takes the styles from the labels
+//
+//  With -c the plots whose files are up to date (see Plotting::SetCache) are skipped and reported as "cached" in the summary.
+//
+//  Each job is run independently. A failing job (missing file, wrong type, Abort of the plotting classes, crash of a worker)
+//  is reported in the summary with its reason, all other jobs are still produced. The exit code is 1 if any job failed.
+
+#include "Drawn.h"
+#include "TError.h"
+#include "TClass.h"
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//  A histogram, graph or function requested in the manifest together with the arguments of its New.. call
+struct PlotObject{
+  TString kind;  //  hist, graph, func, botfunc or ratio
+  TString file;
+  TString key;
+  TString label = "";
+  Int_t style = -1;
+  Int_t size = 1;
+  Int_t color = -1;
+  TString opt = "";  //  Empty means the default option of the New.. function
+};
+
+//  Everything needed to produce one plot
+struct PlotJob{
+  Int_t line = 0;  //  Line in the manifest, used to identify the job in the summary
+  TString type;
+  TString output;
+  TString formats = "";
+  std::vector<PlotObject> objects;
+  std::map<TString, TString> settings;  //  All other key=value pairs
+  std::vector<TString> latex;
+};
+
+//  Outcome of a job as written to the summary
+struct PlotResult{
+  Int_t line = 0;
+  TString output;
+  Bool_t success = false;
+  Double_t seconds = 0;
+  TString message = "";
+};
+
+//  Split s at every sep and strip the whitespace around each part
+std::vector<TString> SplitFields(TString s, const char* sep){
+  std::vector<TString> fields;
+  TObjArray *tokens = s.Tokenize(sep);
+  for(Int_t i = 0; i < tokens->GetEntries(); i++){
+    TString field = ((TObjString*) tokens->At(i))->GetString().Strip(TString::kBoth);
+    if(field.Length()) fields.push_back(field);
+  }
+  delete tokens;
+  return fields;
+}
+
+std::vector<Double_t> SplitNumbers(TString s){
+  std::vector<Double_t> numbers;
+  std::vector<TString> fields = SplitFields(s, ",");
+  for(Int_t i = 0; i < (Int_t)fields.size(); i++) numbers.push_back(fields.at(i).Atof());
+  return numbers;
+}
+
+//  Read all jobs from the manifest. Syntax errors are reported and the line is skipped.
+std::vector<PlotJob> ReadManifest(TString manifest){
+  std::vector<PlotJob> jobs;
+  std::ifstream in(manifest.Data());
+  if(!in) { cerr << "Could not open manifest " << manifest << endl; return jobs; }
+
+  std::string rawline;
+  Int_t linenumber = 0;
+  while(std::getline(in, rawline)){
+    linenumber++;
+    TString line = TString(rawline).Strip(TString::kBoth);
+    if(!line.Length() || line.BeginsWith("#")) continue;
+
+    PlotJob job;
+    job.line = linenumber;
+    std::vector<TString> fields = SplitFields(line, "|");
+    for(Int_t i = 0; i < (Int_t)fields.size(); i++){
+      Ssize_t eq = fields.at(i).Index("=");
+      if(eq < 1) { cerr << "Manifest line " << linenumber << ": ignoring field without key=value: " << fields.at(i) << endl; continue; }
+      TString key = TString(fields.at(i)(0, eq)).Strip(TString::kBoth);
+      TString value = TString(fields.at(i)(eq + 1, fields.at(i).Length() - eq - 1)).Strip(TString::kBoth);
+
+      if(key == "class") job.type = value;
+      else if(key == "output") job.output = value;
+      else if(key == "formats") job.formats = value;
+      else if(key == "latex") job.latex.push_back(value);
+      else if(key == "hist" || key == "graph" || key == "func" || key == "botfunc" || key == "ratio"){
+        Ssize_t colon = value.Last(':');
+        if(colon < 1) { cerr << "Manifest line " << linenumber << ": " << key << " has to be given as file:key" << endl; continue; }
+        PlotObject obj;
+        obj.kind = key;
+        obj.file = value(0, colon);
+        obj.key = value(colon + 1, value.Length() - colon - 1);
+        job.objects.push_back(obj);
+      }
+      else if(key == "label" || key == "style" || key == "size" || key == "color" || key == "opt"){
+        if(job.objects.size() < 1) { cerr << "Manifest line " << linenumber << ": " << key << " given before any object" << endl; continue; }
+        PlotObject &obj = job.objects.back();
+        if(key == "label") obj.label = value;
+        if(key == "style") obj.style = value.Atoi();
+        if(key == "size") obj.size = value.Atoi();
+        if(key == "color") obj.color = value.Atoi();
+        if(key == "opt") obj.opt = value;
+      }
+      else job.settings[key] = value;
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+//  Each worker opens every file and reads every object only once (see PlottingFileCache). The cached object is shared by all jobs reading the same key,
+//  and the plotting classes set its style, title and axis ranges, so every job gets its own copy. The copies live as long as the FileCache of the job
+class FileCache{
+  public:
+    //  Throws with a readable message if the file or the key can't be read
+    TObject* Get(const PlotObject &obj){
+      TString error = "";
+      std::shared_ptr<TObject> o = PlottingFileCache::Get(obj.file, obj.key, error);
+      if(!o) throw std::runtime_error(error.Data());
+      TDirectory::TContext NoDirectory(nullptr);  //  The copy of a hist must not be added to an open file
+      objects.emplace_back(o->Clone());
+      return objects.back().get();
+    }
+
+  private:
+    std::vector<std::unique_ptr<TObject>> objects;
+};
+
+template <class T> T* GetAs(FileCache &cache, const PlotObject &obj){
+  T *o = dynamic_cast<T*>(cache.Get(obj));
+  if(!o) throw std::runtime_error(Form("%s in %s is not a %s", obj.key.Data(), obj.file.Data(), T::Class()->GetName()));
+  return o;
+}
+
+//  TH2s inherit from TH1, so 1D hists are recognized by their dimension
+TH1* GetAs1D(FileCache &cache, const PlotObject &obj){
+  TH1 *h = GetAs<TH1>(cache, obj);
+  if(h->GetDimension() != 1) throw std::runtime_error(Form("%s in %s is not a 1D histogram", obj.key.Data(), obj.file.Data()));
+  return h;
+}
+
+Bool_t Has(const PlotJob &job, TString key){ return job.settings.count(key) > 0; }
+TString Setting(const PlotJob &job, TString key, TString fallback = ""){ return Has(job, key) ? job.settings.at(key) : fallback; }
+Bool_t Flag(const PlotJob &job, TString key){ return Setting(job, key, "0").Atoi() != 0; }
+
+//  Has to be called before the objects are added
+void ApplyTheme(Plotting &P, const PlotJob &job){
+  TString name = Setting(job, "theme", "Classic");
+  const Theme *theme = nullptr;
+  if(name == "Classic") theme = &Themes::Classic;
+  else if(name == "OkabeIto") theme = &Themes::OkabeIto;
+  else if(name == "TolBright") theme = &Themes::TolBright;
+  else if(name == "TolMuted") theme = &Themes::TolMuted;
+  else throw std::runtime_error(Form("Unknown theme '%s'", name.Data()));
+  P.SetTheme(*theme, Flag(job, "hashlabels"));
+}
+
+//  The settings that all plotting classes share
+void ApplyCommonSettings(Plotting &P, const PlotJob &job){
+  if(job.formats.Length()) P.SetFormats(job.formats);
+  if(Has(job, "range")){
+    std::vector<Double_t> r = SplitNumbers(Setting(job, "range"));
+    if(r.size() < 4) throw std::runtime_error("range needs at least xlow,xup,ylow,yup");
+    P.SetAxisRange(r[0], r[1], r[2], r[3], r.size() > 4 ? r[4] : 0, r.size() > 5 ? r[5] : 2);
+  }
+  if(Has(job, "margins")){
+    std::vector<Double_t> m = SplitNumbers(Setting(job, "margins"));
+    if(m.size() < 4) throw std::runtime_error("margins needs at least low,left,up,right");
+    P.SetMargins(m[0], m[1], m[2], m[3], m.size() > 4 ? (Int_t)m[4] : 1200, m.size() > 5 ? (Int_t)m[5] : 1000);
+  }
+  if(Has(job, "legend")){
+    std::vector<Double_t> l = SplitNumbers(Setting(job, "legend"));
+    if(l.size() < 4) throw std::runtime_error("legend needs x1,x2,y1,y2");
+    P.SetLegend(l[0], l[1], l[2], l[3]);
+  }
+  for(Int_t i = 0; i < (Int_t)job.latex.size(); i++){
+    //  Only the first two commas separate the position, the text itself may contain commas
+    TString latex = job.latex.at(i);
+    Ssize_t c1 = latex.Index(",");
+    Ssize_t c2 = c1 < 0 ? -1 : latex.Index(",", c1 + 1);
+    if(c2 < 0) throw std::runtime_error("latex needs x,y,text");
+    P.DrawLatex(TString(latex(0, c1)).Atof(), TString(latex(c1 + 1, c2 - c1 - 1)).Atof(), latex(c2 + 1, latex.Length() - c2 - 1));
+  }
+}
+
+void RunPlotting1D(const PlotJob &job, FileCache &cache){
+  Plotting1D P;
+  ApplyTheme(P, job);
+  for(const PlotObject &obj : job.objects){
+    if(obj.kind == "hist") P.NewHist(GetAs1D(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "p");
+    else if(obj.kind == "graph") P.NewGraph(GetAs<TGraph>(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "p");
+    else if(obj.kind == "func") P.NewFunc(GetAs<TF1>(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "l");
+    else throw std::runtime_error(Form("%s can't be used in class 1D", obj.kind.Data()));
+  }
+  P.SetAxisLabel(Setting(job, "xlabel"), Setting(job, "ylabel"), Setting(job, "xoffset", "1").Atof(), Setting(job, "yoffset", "1").Atof());
+  ApplyCommonSettings(P, job);
+  P.Plot(job.output, Flag(job, "logx"), Flag(job, "logy"));
+}
+
+void RunPlotting2D(const PlotJob &job, FileCache &cache){
+  Plotting2D P;
+  ApplyTheme(P, job);
+  for(const PlotObject &obj : job.objects){
+    if(obj.kind == "hist"){
+      Int_t palette = obj.style == -1 ? kBird : obj.style; //  In 2D the style selects the palette
+      P.NewHist(GetAs<TH2>(cache, obj), obj.opt.Length() ? obj.opt : "COLZ", palette);
+    }
+    else if(obj.kind == "func") P.NewFunc(GetAs<TF1>(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "l");
+    else throw std::runtime_error(Form("%s can't be used in class 2D", obj.kind.Data()));
+  }
+  P.SetAxisLabel(Setting(job, "xlabel"), Setting(job, "ylabel"), Setting(job, "xoffset", "1").Atof(), Setting(job, "yoffset", "1").Atof());
+  ApplyCommonSettings(P, job);
+  P.Plot(job.output, Flag(job, "logx"), Flag(job, "logy"), Flag(job, "logz"), Setting(job, "contours", "100").Atoi());
+}
+
+void RunPlottingRatio(const PlotJob &job, FileCache &cache){
+  PlottingRatio P;
+  ApplyTheme(P, job);
+  for(const PlotObject &obj : job.objects){
+    if(obj.kind == "hist") P.NewHist(GetAs1D(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "p");
+    else if(obj.kind == "ratio") P.NewRatio(GetAs1D(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "p");
+    else if(obj.kind == "func") P.NewTopFunc(GetAs<TF1>(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "l");
+    else if(obj.kind == "botfunc") P.NewBotFunc(GetAs<TF1>(cache, obj), obj.label, obj.style, obj.size, obj.color, obj.opt.Length() ? obj.opt : "l");
+    else throw std::runtime_error(Form("%s can't be used in class Ratio", obj.kind.Data()));
+  }
+  P.SetAxisLabel(Setting(job, "xlabel"), Setting(job, "ylabel"), Setting(job, "zlabel", "Ratio"), Setting(job, "xoffset", "1").Atof(), Setting(job, "yoffset", "1").Atof());
+  if(Has(job, "legendr")){
+    std::vector<Double_t> l = SplitNumbers(Setting(job, "legendr"));
+    if(l.size() < 4) throw std::runtime_error("legendr needs x1,x2,y1,y2");
+    P.SetLegendR(l[0], l[1], l[2], l[3]);
+  }
+  ApplyCommonSettings(P, job);
+  P.Plot(job.output, Flag(job, "logx"), Flag(job, "logy"), Flag(job, "logz"));
+}
+
+//  Produce a single plot. Nothing thrown inside (also not by Plotting::Abort) leaves this function.
+PlotResult RunJob(const PlotJob &job, FileCache &cache){
+  PlotResult result;
+  result.line = job.line;
+  result.output = job.output;
+  auto start = std::chrono::steady_clock::now();
+  Int_t hits = Plotting::GetCacheHits();
+  try{
+    if(!job.output.Length()) throw std::runtime_error("No output given");
+    if(job.type == "1D") RunPlotting1D(job, cache);
+    else if(job.type == "2D") RunPlotting2D(job, cache);
+    else if(job.type == "Ratio") RunPlottingRatio(job, cache);
+    else throw std::runtime_error(Form("Unknown class '%s' (use 1D, 2D or Ratio)", job.type.Data()));
+    result.success = true;
+    if(Plotting::GetCacheHits() > hits) result.message = "cached";
+  }
+  catch(const std::exception &e){
+    result.message = e.what();
+  }
+  result.seconds = std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+//  Results are sent from the workers to the main process as one tab separated line per job
+TString FormatResult(const PlotResult &r){
+  TString message = r.message;
+  message.ReplaceAll("\t", " ");
+  message.ReplaceAll("\n", " ");
+  return TString::Format("%d\t%s\t%.4f\t%s\t%s\n", r.line, r.success ? "ok" : "failed", r.seconds, r.output.Data(), message.Data());
+}
+
+PlotResult ParseResult(TString line){
+  PlotResult r;
+  //  Split at every tab by hand, Tokenize drops empty fields and would shift an empty output into the message
+  std::vector<TString> fields;
+  Ssiz_t from = 0;
+  for(Ssiz_t tab = line.Index("\t"); tab != kNPOS; tab = line.Index("\t", from)){
+    fields.push_back(line(from, tab - from));
+    from = tab + 1;
+  }
+  fields.push_back(line(from, line.Length() - from));
+  if(fields.size() >= 4){
+    r.line = fields.at(0).Atoi();
+    r.success = fields.at(1) == "ok";
+    r.seconds = fields.at(2).Atof();
+    r.output = fields.at(3);
+    if(fields.size() > 4) r.message = fields.at(4);
+  }
+  return r;
+}
+
+//  Worker iworker produces every nworkers-th job and writes the results into fd
+void RunWorker(const std::vector<PlotJob> &jobs, Int_t iworker, Int_t nworkers, Int_t fd){
+  for(Int_t i = iworker; i < (Int_t)jobs.size(); i += nworkers){
+    FileCache cache;  //  The copies of one job are deleted after its plot is written
+    TString line = FormatResult(RunJob(jobs.at(i), cache));
+    if(write(fd, line.Data(), line.Length()) < 0) _exit(1); //  The main process reports every job without a result as failed
+  }
+}
+
+int main(int argc, char **argv){
+
+  TString manifest = "";
+  TString summary = "PlotFarm_summary.tsv";
+  TString cacheindex = "";
+  Int_t nworkers = (Int_t)sysconf(_SC_NPROCESSORS_ONLN);
+  for(Int_t i = 1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg == "-j" && i + 1 < argc) nworkers = TString(argv[++i]).Atoi();
+    else if(arg == "-s" && i + 1 < argc) summary = argv[++i];
+    else if(arg == "-c" && i + 1 < argc) cacheindex = argv[++i];
+    else manifest = arg;
+  }
+  if(!manifest.Length()){
+    cerr << "Usage: " << argv[0] << " manifest.txt [-j workers] [-s summary.tsv] [-c cacheindex]" << endl;
+    return 1;
+  }
+
+  std::vector<PlotJob> jobs = ReadManifest(manifest);
+  if(jobs.size() < 1) { cerr << "No jobs found in " << manifest << endl; return 1; }
+  if(nworkers < 1) nworkers = 1;
+  if(nworkers > (Int_t)jobs.size()) nworkers = jobs.size();
+
+  gROOT->SetBatch(kTRUE);
+  gErrorIgnoreLevel = kWarning; //  Don't print a line for every created file
+  Plotting::SetThrowOnAbort(true);  //  A broken plot must not end the whole farm
+  if(cacheindex.Length()) Plotting::SetCache(cacheindex);  //  Read once here, every worker inherits it and appends what it writes
+
+  auto start = std::chrono::steady_clock::now();
+
+  //  Fork the workers. Every worker pays ROOTs startup only once (it is inherited) and then runs its share of the jobs
+  std::vector<pid_t> pids;
+  std::vector<Int_t> fds;
+  for(Int_t w = 0; w < nworkers; w++){
+    Int_t fd[2];
+    if(pipe(fd) != 0) { cerr << "Could not create pipe for worker " << w << endl; return 1; }
+    pid_t pid = fork();
+    if(pid < 0) { cerr << "Could not fork worker " << w << endl; return 1; }
+    if(pid == 0){
+      close(fd[0]);
+      for(Int_t other : fds) close(other);  //  Pipes of the workers forked before
+      RunWorker(jobs, w, nworkers, fd[1]);
+      close(fd[1]);
+      _exit(0);  //  Skip ROOTs teardown, the main process still owns everything
+    }
+    close(fd[1]);
+    pids.push_back(pid);
+    fds.push_back(fd[0]);
+  }
+
+  //  Collect the results. Every worker only blocks on its own pipe, so reading them one after the other can't deadlock
+  std::map<Int_t, PlotResult> results;
+  for(Int_t w = 0; w < nworkers; w++){
+    std::string buffer;
+    char chunk[4096];
+    ssize_t n;
+    while((n = read(fds.at(w), chunk, sizeof(chunk))) > 0) buffer.append(chunk, n);
+    close(fds.at(w));
+    std::vector<TString> lines = SplitFields(buffer, "\n");
+    for(Int_t i = 0; i < (Int_t)lines.size(); i++){
+      PlotResult r = ParseResult(lines.at(i));
+      results[r.line] = r;
+    }
+
+    Int_t status = 0;
+    waitpid(pids.at(w), &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+      //  The worker crashed (e.g. segmentation violation inside ROOT). All its jobs without result are failures
+      TString reason = WIFSIGNALED(status) ? Form("Worker crashed with signal %d", WTERMSIG(status)) : Form("Worker exited with code %d", WEXITSTATUS(status));
+      for(Int_t i = w; i < (Int_t)jobs.size(); i += nworkers){
+        if(results.count(jobs.at(i).line)) continue;
+        PlotResult r;
+        r.line = jobs.at(i).line;
+        r.output = jobs.at(i).output;
+        r.message = reason;
+        results[r.line] = r;
+      }
+    }
+  }
+
+  Double_t wall = std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+
+  //  Write the summary sorted by manifest line
+  std::ofstream out(summary.Data());
+  out << "line\tstatus\tseconds\toutput\tmessage\n";
+  Int_t nfailed = 0;
+  Int_t ncached = 0;
+  Double_t cpu = 0;
+  for(auto &entry : results){
+    out << FormatResult(entry.second).Data();
+    if(entry.second.success && entry.second.message == "cached") ncached++;
+    if(!entry.second.success){
+      nfailed++;
+      cerr << "Line " << entry.first << " (" << entry.second.output << ") failed: " << entry.second.message << endl;
+    }
+    cpu += entry.second.seconds;
+  }
+  out.close();
+
+  cout << results.size() - nfailed << " of " << jobs.size() << " plots produced (" << ncached << " up to date), " << nfailed << " failed. "
+       << Form("%.1f s wall time, %.1f s summed over %d workers. Summary written to %s", wall, cpu, nworkers, summary.Data()) << endl;
+  return nfailed > 0 ? 1 : 0;
+}